@@ -43,6 +43,24 @@
 // Version 1.07   2018 june 17    by Koepel
 // Added error count.
 //
+// Version 1.08   2026 october 18
+// The put() and get() templates are thin functions that call a single
+// _put() and _get(), to avoid a copy of the transfer code for every type.
+// Fixed the size of the parts, the register address is in the same buffer.
+// See extras/SizeReport for the Flash and RAM that is used.
+// Added readStream() and writeStream() and block select bits for
+// I2C EEPROMs with more than 64 kbyte.
+// Added setPageSize() for writing to an I2C EEPROM.
+// The Arduino.h is only included for an Arduino board, the CommonSensorClass
+// can be used on a computer with a Wire compatible class.
+// Added extras/ParallelAcquisition for a computer with more than one I2C bus.
+// Added automatic tuning of the I2C clock for every sensor,
+// when COMMONSENSORCLASS_CLOCK_TUNING is defined.
+// Added the SMBus PEC with CSC_SMBUS_PEC.
+// Added CommonSensorFifo.h to read the FIFO of a sensor.
+// Added CSC_NO_AUTO_INCREMENT.
+// Added CommonSensorTarget.h, the Slave code that works with this class.
+//
 //
 //
 //
@@ -83,6 +101,7 @@
 //    This will be hard to implement, because there are too many ways for the delay.
 //
 //    Make Slave code that works well with this class.
+//      Done: CommonSensorTarget.h
 //
 //    Support other busses (SPI, 1-Wire, Serial).
 //
@@ -103,10 +122,13 @@
 
 
 #include <inttypes.h>
+#include <stddef.h>
+#if defined( ARDUINO)
 #include <Arduino.h>
+#endif
 
 
-#define COMMONSENSORCLASS_VERSION 106
+#define COMMONSENSORCLASS_VERSION 108
 
 
 // The buffer size of the used Wire library.
@@ -115,7 +137,56 @@
 // for SAMD processors.
 // This could be set automatically. 
 // Not tested yet if the .availableForWrite() works for the Arduino Wire library.
+// It can be set before including this file, for example to 255 for the SAMD,
+// then fewer I2C transactions are needed for a large amount of data.
+// The maximum is 255, because the length for Wire.requestFrom() is a byte.
+#ifndef COMMONSENSORCLASS_WIRE_BUFFER_SIZE
 #define COMMONSENSORCLASS_WIRE_BUFFER_SIZE 32
+#endif
+
+
+// The maximum time in milliseconds for an I2C EEPROM to finish writing a page.
+// See setPageSize().
+// Most I2C EEPROMs need 5ms or 10ms, the time does not depend on the I2C clock.
+#ifndef COMMONSENSORCLASS_WRITE_TIMEOUT
+#define COMMONSENSORCLASS_WRITE_TIMEOUT 20
+#endif
+
+// The time in milliseconds for the write timeout.
+// It can be set before including this file, for another time source.
+#ifndef COMMONSENSORCLASS_MILLIS
+#if defined( ARDUINO)
+#define COMMONSENSORCLASS_MILLIS() millis()
+#else
+#include <chrono>
+#define COMMONSENSORCLASS_MILLIS() ((unsigned long) std::chrono::duration_cast<std::chrono::milliseconds>( \
+          std::chrono::steady_clock::now().time_since_epoch()).count())
+#endif
+#endif
+
+
+// Automatic tuning of the I2C clock for every sensor.
+// Define COMMONSENSORCLASS_CLOCK_TUNING before including this file to use it.
+// The Wire library must have the setClock() function.
+// See enableClockTuning().
+//
+// The number of good I2C transactions before the next higher clock is tried.
+#ifndef COMMONSENSORCLASS_CLOCK_STEP_COUNT
+#define COMMONSENSORCLASS_CLOCK_STEP_COUNT 100
+#endif
+
+// The number of times in a row that the sensor does not acknowledge its I2C address,
+// before the clock goes down. A busy sensor does that once in a while,
+// a sensor that can not run at the clock does it every time.
+#ifndef COMMONSENSORCLASS_CLOCK_NACK_COUNT
+#define COMMONSENSORCLASS_CLOCK_NACK_COUNT 3
+#endif
+
+// The number of good I2C transactions after an error,
+// before the clock that gave the error is tried again.
+#ifndef COMMONSENSORCLASS_CLOCK_RETRY_COUNT
+#define COMMONSENSORCLASS_CLOCK_RETRY_COUNT 10000
+#endif
 
 
 // CSC is short for COMMONSENSORCLASS
@@ -127,6 +198,44 @@
 #define CSC_24BIT_SIGNED              0x00000020  // The sensor has 24-bit signed data.
 #define CSC_24BIT_UNSIGNED            0x00000040  // The sensor has 24-bit unsigned data;
 #define CSC_SENSOR_LSB_FIRST          0x00000080  // The sensor has the register address and data as LSB first.
+#define CSC_BLOCK_SELECT_1_BIT        0x00000100  // Address bit 16 is in the I2C address (24LC1026, AT24CM01).
+#define CSC_BLOCK_SELECT_2_BITS       0x00000200  // Address bits 17..16 are in the I2C address (24M02, AT24CM02).
+#define CSC_BLOCK_SELECT_3_BITS       0x00000300  // Address bits 18..16 are in the I2C address.
+#define CSC_BLOCK_SELECT_AT_BIT_2     0x00000400  // The block select bit is bit 2 of the I2C address (24LC1025).
+#define CSC_SMBUS_PEC                 0x00001000  // The sensor uses the SMBus Packet Error Checking (CRC-8).
+#define CSC_NO_AUTO_INCREMENT         0x00002000  // The register address in the sensor does not increase with every byte.
+
+#define CSC_BLOCK_SELECT_MASK         0x00000300  // The number of block select bits.
+
+// The error codes of Wire.endTransmission() that are used by the clock tuning.
+#define CSC_I2C_ADDRESS_NACK          2           // No acknowledge of the I2C address, the sensor might be busy.
+#define CSC_I2C_OTHER_ERROR           4           // Some other error, also used when Wire.requestFrom() fails.
+
+// Large I2C EEPROMs have more than 64 kbyte, but the register address is 16 bits.
+// The higher bits of the memory address are in the I2C address.
+// The 64 kbyte that belongs to one I2C address is called a block.
+// For example the 24LC1025 with A1 and A0 low:
+//    mem.begin( 0x50, CSC_REGISTER_ADDRESS_SIZE_2 | CSC_BLOCK_SELECT_1_BIT | CSC_BLOCK_SELECT_AT_BIT_2);
+//    mem.setPageSize( 128);
+//    mem.readStream( 0x0FFF0, buffer, 4096);      // crosses the block boundary at 0x10000
+
+// With the SMBus PEC, a CRC-8 is added after the data of every I2C transaction.
+// The CRC is calculated over the I2C addresses (with the R/W bit), the register address and the data.
+// The sensor checks it for put(), the CommonSensorClass checks it for get().
+// That is only one extra byte, instead of reading the data back to check it.
+// A wrong PEC is counted separately, see getPecErrorCount().
+// A put() with a repeated start (I2Cstop is false) is the first part of
+// a longer transaction and does not get a PEC.
+//
+// The table for the CRC-8 of the SMBus PEC is in Flash memory for the AVR.
+#if defined( __AVR__)
+#include <avr/pgmspace.h>
+#define CSC_PROGMEM PROGMEM
+#define CSC_READ_TABLE( p) pgm_read_byte( p)
+#else
+#define CSC_PROGMEM
+#define CSC_READ_TABLE( p) (*(p))
+#endif
 
 
 template <class T_WIRE_LIBRARY> class CommonSensorClass
@@ -158,6 +267,12 @@ public:
     _descriptor = sensorDescriptor;  // Store the desciptor, no error checking yet.
     
     _errorCount = 0;                 // clear the common error count
+    _pecErrorCount = 0;
+    _pageSize = 0;
+#ifdef COMMONSENSORCLASS_CLOCK_TUNING
+    _clock = 0;                      // do not change the I2C clock
+    _clockTuning = false;
+#endif
   }
 
 
@@ -176,154 +291,21 @@ public:
   // The function put() can be used in two ways:
   //    Either with a variable, then the size of the variable itself is used.
   //    Or when the variable is a single byte then the parameter 'size' is used for the bytes to transfer.
-  template <typename T> bool put( uint16_t registerAddress, const T (&t), size_t size, bool I2Cstop = true)
+  //
+  // The put() and get() templates are only a thin layer over the functions
+  // _put() and _get(), which do the real work.
+  // A template creates new code for every type that is used, and that would
+  // create a copy of the large transfer loops for every type.
+  template <typename T> bool put( uint16_t registerAddress, const T (&t), size_t size = sizeof( T), bool I2Cstop = true)
   {
-    if( _descriptor == 0)                         // safety check if .begin() was called.
-    {
-      return( false);
-    }
-    
-    const uint8_t *ptr = (const uint8_t*) &t;
-    bool success = true;           // default true, make it false if something fails later on.
-
-    size_t totalSize = sizeof( T);
-    size_t bytesPerElement = size;
-
-    // Test if the I2C action has to be done without data.
-    if( size == 0)
-    {
-      totalSize = 0;
-    }
-    else
-    {
-      // Test if the size was used as the number of bytes and data is a pointer
-      if( totalSize == 1)
-      {
-        totalSize = size;
-        bytesPerElement = 1;
-      }
-    }
-
-    // If more data needs to be transmitted, then split it into seperate parts.
-    // Increase the registerAddress for each part.
-    // It is allowed to do one I2C bus transaction without data.
-    
-    do
-    {
-      size_t bytesToTransfer = min( COMMONSENSORCLASS_WIRE_BUFFER_SIZE, totalSize);
-      
-      // Clip the bytes to transfer to a multiple of the element size.
-      // This is not a problem for the AVR Wire library which has a buffer of 32 bytes,
-      // but the TinyWire has only 18 bytes and the ATSAM has 255 bytes.
-      if( elementSize > 1)
-      {
-        bytesToTransfer = (bytesToTransfer / elementSize) * elementSize;
-      }
-
-      _WireLib.beginTransmission( (uint8_t) _device_address);
-
-      if( (_descriptor & CSC_NO_REGISTER_ADDRESS) != 0)
-      {
-        // the sensor has no register address
-      }
-      else if( (_descriptor & CSC_REGISTER_ADDRESS_SIZE_1) != 0)
-      {
-        _WireLib.write( (uint8_t) registerAddress);
-      }
-      else if( (_descriptor & CSC_REGISTER_ADDRESS_SIZE_2) != 0)
-      {
-        if( (_descriptor & CSC_SENSOR_LSB_FIRST) != 0)
-        {
-          // Is there a sensor with the register address LSB first ?
-          _WireLib.write( (uint8_t) registerAddress);
-          _WireLib.write( (uint8_t) (registerAddress >> 8));
-        }
-        else
-        {
-          // MSB is written first for most sensors.
-          _WireLib.write( (uint8_t) (registerAddress >> 8));
-          _WireLib.write( (uint8_t) registerAddress);
-        }
-      }
-
-      if( bytesToTransfer > 0)
-      {
-        for( size_t i=0; i<(totalSize / bytesPerElement); i++)
-        {
-          switch( bytesPerElement)
-          {
-            case 0:
-              break;
-            case 1:
-              _WireLib.write( *ptr++);
-              break;
-            case 2:
-              {                     // allow local variables with extra brackets
-                uint16_t *p = (uint16_t *) ptr;
-                uint16_t data16 = *p;
-                ptr += 2;
-                if( (_descriptor & CSC_SENSOR_LSB_FIRST) == 0)
-                {
-                  // MSB first, this is normal
-                  _WireLib.write( (uint8_t) (data16 >> 8));
-                  _WireLib.write( (uint8_t) data16);
-                }
-                else
-                {
-                  // LSB first, this is not normal, but some sensors have LSB first.
-                  _WireLib.write( (uint8_t) data16);
-                  _WireLib.write( (uint8_t) (data16 >> 8));
-                }
-              }
-              break;
-            case 4:
-              // The data needs to be stored into 4 bytes.
-              {                               // allow local variables with extra brackets
-                uint32_t *p = (uint32_t *) ptr;
-                uint32_t data32 = *p;
-                ptr += 4;
-                if( (_descriptor & CSC_SENSOR_LSB_FIRST) == 0)
-                {
-                  // MSB first, this is normal
-                  _WireLib.write( (uint8_t) (data32 >> 24));
-                  _WireLib.write( (uint8_t) (data32 >> 16));
-                  _WireLib.write( (uint8_t) (data32 >> 8));
-                  _WireLib.write( (uint8_t) data32);
-                }
-                else
-                {
-                  // LSB first, this is not normal, but some sensors have LSB first.
-                  _WireLib.write( (uint8_t) data32);
-                  _WireLib.write( (uint8_t) (data32 >> 8));
-                  _WireLib.write( (uint8_t) (data32 >> 16));
-                  _WireLib.write( (uint8_t) (data32 >> 24));
-                }
-              }
-              break;
-            }
-        }
-      }
-
-      uint8_t error = _WireLib.endTransmission( I2Cstop);     // send true for a stop, false for repeated start.
-      if( error != 0)
-      {
-        success = false;                      // Some kind of I2C bus error, stop sending data.
-        _errorCount++;                        // increase the common error count
-      }
-
-      totalSize -= bytesToTransfer;
-      registerAddress += bytesToTransfer;
-    }
-    while( totalSize > 0 && success);
-    
-    return( success);              // return true if success, that means true if no error.
+    return( _put( registerAddress, (const uint8_t *) &t, sizeof( T), size, I2Cstop));
   }
 
   template <typename T, size_t N> bool put( uint16_t registerAddress, const T (&t)[N])
   {
     // The 'T' is the base type, not the whole array.
     // Therefor the sizeof(T) is the size of the base type.
-    return( put( registerAddress, t, sizeof( T)));
+    return( _put( registerAddress, (const uint8_t *) t, sizeof( t), sizeof( T), true));
   }
   
 
@@ -337,239 +319,56 @@ public:
   // The optional baseSize is when for example 3 bytes (24-bits) are read and
   // put into a 4 byte variable.
   // When for example an array of 3 set of 4 bytes each is used for 24-bit sensor values,
-  // then the baseSize should be 3.
+  // then the descriptor should have CSC_24BIT_SIGNED or CSC_24BIT_UNSIGNED.
   // Converting them to a signed int should be done by the user.
   //
   // Getting the MSB and LSB in the right order should work for every processor.
-  // This is achieved by reading the bytes from the sensor assuming MSB first and
-  // then shifting them in the right place in a variable. The compiler will take care
-  // that the MSB is stored in the MSB and the LSB in the LSB.
   //
   // The function get() can be used in two ways:
   //    Either with a variable, then the size of the variable is used.
   //    The 'baseSize' is the number of bytes in the sensor that belong together.
   //    Or when the variable is a single byte then the parameter 'baseSize' is used 
   //    for the amount of bytes to transfer.
-  template <typename T> bool get( uint16_t registerAddress, T (&t), size_t size)
+  template <typename T> bool get( uint16_t registerAddress, T (&t), size_t size = sizeof( T))
   {
-    if( _descriptor == 0)                  // safety check if .begin() was not called.
-    {
-      return( false);
-    }
-    
-    uint8_t *ptr = (uint8_t *) &t;
-    bool success = true;           // default true, make it false if something fails later on.
+    return( _get( registerAddress, (uint8_t *) &t, sizeof( T), size));
+  }
 
-    size_t totalSize = sizeof( T);
-    size_t bytesPerElement = size;
+  template <typename T, size_t N> bool get( uint16_t registerAddress, T (&t)[N])
+  {
+    return( _get( registerAddress, (uint8_t *) t, sizeof( t), sizeof( T)));
+  }
 
-    // Test if the 'size' was used as the number of bytes and data is a pointer
-    if( totalSize == 1)
-    {
-      totalSize = size;
-      bytesPerElement = 1;
-    }
 
-    // Test if the sensor uses a register address.
-    // Some sensors (like the BH1750) don't have a register address in the sensor.
-    if( (_descriptor & CSC_NO_REGISTER_ADDRESS) == 0)           // the bit for no register address is not active ?
-    {
-      // A repeated start after setting the register address is the default.
-      bool stopI2C = (_description & CSC_NO_REPEATED_START) == 0;
-      success = put( registerAddress, NULL, stopI2C);
-    }
-
-    if( success)
-    {
-      // If more data is requested than the buffer size of the used Wire library,
-      // then split the request into seperate parts.
-      // This is no need to write the register address, 
-      // the Wire.requestFrom() is called multiple times.
-      do
-      {
-        size_t bytesToTransfer = min( COMMONSENSORCLASS_WIRE_BUFFER_SIZE, totalSize);
+  // The readStream() and writeStream() are for a large amount of bytes,
+  // for example to make a copy of a whole I2C EEPROM.
+  // The address can be more than 16 bits, for an I2C EEPROM that
+  // has block select bits in the I2C address (see CSC_BLOCK_SELECT_1_BIT).
+  // The I2C address is changed automatically when a block boundary is crossed.
+  //
+  // The readStream() writes the register address only once for every block,
+  // and reads the data in parts of the buffer size of the Wire library.
+  // return value: true = success, false = fail or bus error.
+  bool readStream( uint32_t address, uint8_t *pData, size_t size)
+  {
+    return( _get( address, pData, 1, size));
+  }
 
-        // Clip the bytes to transfer to a multiple of the element size.
-        // This is not a problem for the AVR Wire library which has a buffer of 32 bytes,
-        // but the TinyWire has only 18 bytes and the ATSAM has 255 bytes.
-        if( elementSize > 1)
-        {
-          bytesToTransfer = (bytesToTransfer / elementSize) * elementSize;
-        }
-        
-        size_t n = (size_t) _WireLib.requestFrom( (uint8_t) _device_address, bytesToTransfer);
-        if( n == bytesToTransfer)
-        {
-          // The right amount of bytes have been received, 
-          // That means that valid received bytes are in the buffer.
-          // Therefor it is no need to test every Wire.read for -1.
-          
-          // MSB is often the first byte in a sensor.
-          // However, the Arduino AVR family has the LSB at the lowest memory location.
-          // It is therefor not possible to copy the data directly into the variable.
-          // By shifting the bytes into their place, the compiler takes automatically
-          // care of the right MSB-LSB order.
-          //
-          // The baseSize is needed, because if 12 bytes would be requested it could
-          // be 3 sets of 4 bytes or 4 sets of 3 bytes or 6 sets of 2 bytes, and so on.
-
-          for( size_t i=0; i<(totalSize / bytesPerElement); i++)
-          {
-            switch( bytesPerElement)
-            {
-            case 0:
-              break;
-            case 1:
-              *ptr++ = (uint8_t) _WireLib.read();
-              break;
-            case 2:
-              {                     // allow local variables with extra brackets
-                uint16_t data16 = 0;
-                if( (_descriptor & CSC_SENSOR_LSB_FIRST) == 0)
-                {
-                  // MSB first, this is normal
-                  data16 = uint16_t( _WireLib.read()) << 8;
-                  data16 |= _WireLib.read();
-                }
-                else
-                {
-                  // LSB first, this is not normal, but some sensors have LSB first.
-                  data16 = _WireLib.read();
-                  data16 |= uint16_t( _WireLib.read()) << 8;
-                }
-                uint16_t *p = (uint16_t *) ptr;
-                *p = data16;
-                ptr += 2;
-              }
-              break;
-            case 4:
-              // The data needs to be stored into 4 bytes.
-              // Test if the sensor has 3-byte values that needs to be stored in 4-bytes variables.
-              if( (_descriptor & CSC_24BIT_SIGNED) != 0 && totalSize > 3)
-              {
-                uint32_t data3x8 = 0;
-                if( (_descriptor & CSC_SENSOR_LSB_FIRST) == 0)
-                {
-                  // MSB first, this is normal
-                  data3x8 = uint32_t( _WireLib.read()) << 16;
-                  data3x8 |= uint32_t( _WireLib.read()) << 8;
-                  data3x8 |= _WireLib.read();
-                }
-                else
-                {
-                  // LSB first, this is not normal, but some sensors have LSB first.
-                  data3x8 = _WireLib.read();
-                  data3x8 |= uint32_t( _WireLib.read()) << 8;
-                  data3x8 |= uint32_t( _WireLib.read()) << 16;
-                }
-
-                // extend sign to the MSB byte.
-                if( (data3x8 & 0x00800000) != 0)
-                {
-                  data3x8 |= 0xFF000000;
-                }
-
-                uint32_t *p = (uint32_t *) ptr;
-                *p = data3x8;
-                ptr += 4;
-              }
-              else if( (_descriptor & CSC_24BIT_UNSIGNED) != 0 && totalSize > 3)
-              {
-                uint32_t data3x8 = 0;
-                if( (_descriptor & CSC_SENSOR_LSB_FIRST) == 0)
-                {
-                  // MSB first, this is normal
-                  data3x8 = uint32_t( _WireLib.read()) << 16;
-                  data3x8 |= uint32_t( _WireLib.read()) << 8;
-                  data3x8 |= _WireLib.read();
-                }
-                else
-                {
-                  // LSB first, this is not normal, but some sensors have LSB first.
-                  data3x8 = _WireLib.read();
-                  data3x8 |= uint32_t( _WireLib.read()) << 8;
-                  data3x8 |= uint32_t( _WireLib.read()) << 16;
-                }
-                uint32_t *p = (uint32_t *) ptr;
-                *p = data3x8;
-                ptr += 4;
-              }
-              else
-              {
-                uint32_t data32 = 0;
-                if( (_descriptor & CSC_SENSOR_LSB_FIRST) == 0)
-                {
-                  // MSB first, this is normal
-                  data32 = uint32_t( _WireLib.read()) << 24;
-                  data32 |= uint32_t( _WireLib.read()) << 16;
-                  data32 |= uint32_t( _WireLib.read()) << 8;
-                  data32 |= _WireLib.read();
-                }
-                else
-                {
-                  // LSB first, this is not normal, but some sensors have LSB first.
-                  data32 = _WireLib.read();
-                  data32 |= uint32_t( _WireLib.read()) << 8;
-                  data32 |= uint32_t( _WireLib.read()) << 16;
-                  data32 |= uint32_t( _WireLib.read()) << 24;
-                }
-                uint32_t *p = (uint32_t *) ptr;
-                *p = data32;
-                ptr += 4;
-              }
-              break;
-            case 8:
-              {                     // allow local variables with extra brackets
-                uint64_t data64 = 0;
-                if( (_descriptor & CSC_SENSOR_LSB_FIRST) == 0)
-                {
-                  // MSB first, this is normal
-                  data64 = uint64_t( _WireLib.read()) << 56;
-                  data64 |= uint64_t( _WireLib.read()) << 48;
-                  data64 |= uint64_t( _WireLib.read()) << 40;
-                  data64 |= uint64_t( _WireLib.read()) << 32;
-                  data64 |= uint64_t( _WireLib.read()) << 24;
-                  data64 |= uint64_t( _WireLib.read()) << 16;
-                  data64 |= uint64_t( _WireLib.read()) << 8;
-                  data64 |= _WireLib.read();
-                }
-                else
-                {
-                  // LSB first, this is not normal, but some sensors have LSB first.
-                  data64 = _WireLib.read();
-                  data64 |= uint64_t( _WireLib.read()) << 8;
-                  data64 |= uint64_t( _WireLib.read()) << 16;
-                  data64 |= uint64_t( _WireLib.read()) << 24;
-                  data64 |= uint64_t( _WireLib.read()) << 32;
-                  data64 |= uint64_t( _WireLib.read()) << 40;
-                  data64 |= uint64_t( _WireLib.read()) << 48;
-                  data64 |= uint64_t( _WireLib.read()) << 56;
-                }
-                uint64_t *p = (uint64_t *) ptr;
-                *p = data64;
-                ptr += 8;
-              }
-              break;
-            }
-          }
-  
-          totalSize -= bytesToTransfer;
-        }
-        else
-        {
-          // The Wire.requestFrom() failed.
-          success = false;
-          _errorCount++;        // increase the common error count
-        }
-      } while( totalSize > 0 && success);
-    }
-    
-    return( success);
+  // The data is split at a page boundary, when the page size is set.
+  bool writeStream( uint32_t address, const uint8_t *pData, size_t size)
+  {
+    return( _put( address, pData, 1, size, true));
   }
 
-  template <typename T, size_t N> bool get( uint16_t registerAddress, const T (&t)[N])
+  // An I2C EEPROM can only write inside a page, and it does not respond
+  // to the I2C bus while it is writing.
+  // When the page size is set, the data is split at every page boundary and
+  // the EEPROM is checked after writing every part, until it is ready.
+  // When it is still busy after COMMONSENSORCLASS_WRITE_TIMEOUT, the put() fails.
+  // The page size should be a power of two. Zero means no pages (the default).
+  void setPageSize( uint16_t pageSize)
   {
-    return( get( registerAddress, t, sizeof( T)));
+    _pageSize = pageSize;
   }
   
   
@@ -697,15 +496,627 @@ public:
   void clearErrorCount()
   {
     _errorCount = 0;
+    _pecErrorCount = 0;
+  }
+
+  // The number of times that the PEC of the received data was wrong.
+  // They are not in the common error count.
+  uint16_t getPecErrorCount()
+  {
+    return( _pecErrorCount);
+  }
+
+#ifdef COMMONSENSORCLASS_CLOCK_TUNING
+  // The I2C clock is tuned for this sensor.
+  // It starts at 100kHz, and after a number of good I2C transactions,
+  // the next higher clock is tried: 100kHz, 400kHz, 1MHz.
+  // When an error happens, the clock goes one step down and stays there
+  // for COMMONSENSORCLASS_CLOCK_RETRY_COUNT good I2C transactions,
+  // then the higher clock is tried again.
+  // When errors happen again, it goes further down.
+  // A sensor that does not acknowledge its I2C address (for example when it is busy)
+  // is counted as an error, but the clock only goes down when that happens
+  // COMMONSENSORCLASS_CLOCK_NACK_COUNT times in a row.
+  // The clock is set with Wire.setClock() before every put() and get() of this sensor,
+  // so sensors on the same I2C bus can run at a different clock.
+  // Every sensor on that bus should use enableClockTuning() or setDeviceClock(),
+  // or else a sensor is used with the clock of the sensor before it.
+  // The begin() turns the tuning off, call this after begin().
+  void enableClockTuning( uint32_t maxClock = 1000000UL)
+  {
+    _clockIndex = 0;
+    _clockLimit = 0;
+    while( _clockLimit + 1 < _clockRateCount() && _clockRate( _clockLimit + 1) <= maxClock)
+    {
+      _clockLimit++;
+    }
+    _clockCeiling = _clockLimit;
+    _clockSuccess = 0;
+    _clockNackCount = 0;
+    _clockTuning = true;
+    _clock = _clockRate( _clockIndex);
+  }
+
+  // Use a fixed I2C clock for this sensor. Zero to not change the clock.
+  // The begin() resets it, call this after begin().
+  void setDeviceClock( uint32_t clock)
+  {
+    _clockTuning = false;
+    _clock = clock;
   }
 
+  // The I2C clock for this sensor. Zero means that the clock is not changed.
+  uint32_t getClock()
+  {
+    return( _clock);
+  }
+#endif
+
 private:
+  // Test if the processor has the LSB at the lowest memory location.
+  // The AVR, ARM, ESP and x86 processors are little endian.
+  // When the compiler does not tell, little endian is assumed.
+  static bool _littleEndian()
+  {
+#if defined( __BYTE_ORDER__) && defined( __ORDER_BIG_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    return( false);
+#else
+    return( true);
+#endif
+  }
+
+  // The buffer size of the Wire library, the maximum number of bytes for one I2C transaction.
+  static size_t _bufferSize()
+  {
+    return( COMMONSENSORCLASS_WIRE_BUFFER_SIZE > 255 ? 255 : COMMONSENSORCLASS_WIRE_BUFFER_SIZE);
+  }
+
+  // The number of bytes of the register address in the sensor.
+  size_t _addressSize()
+  {
+    if( (_descriptor & CSC_NO_REGISTER_ADDRESS) != 0)
+    {
+      return( 0);
+    }
+    else if( (_descriptor & CSC_REGISTER_ADDRESS_SIZE_2) != 0)
+    {
+      return( 2);
+    }
+    return( 1);
+  }
+
+  // The size of the data and the size of the elements of the data.
+  // The 'dataSize' is the sizeof() of the variable, the 'size' is the
+  // parameter of put() and get().
+  // Returns false when there is no data to transfer.
+  static bool _sizes( size_t dataSize, size_t size, size_t & totalSize, size_t & bytesPerElement)
+  {
+    totalSize = dataSize;
+    bytesPerElement = size;
+
+    // Test if the I2C action has to be done without data.
+    if( size == 0)
+    {
+      totalSize = 0;
+      bytesPerElement = 1;
+      return( false);
+    }
+
+    // Test if the size was used as the number of bytes and data is a pointer
+    if( totalSize == 1)
+    {
+      totalSize = size;
+      bytesPerElement = 1;
+    }
+
+    // Something else (a struct ?) is transferred as bytes.
+    if( bytesPerElement != 2 && bytesPerElement != 4 && bytesPerElement != 8)
+    {
+      bytesPerElement = 1;
+    }
+    return( true);
+  }
+
+  // The number of bytes of an element on the I2C bus for get().
+  // That is 3 for a 24-bit sensor value that is stored in a 4 byte variable.
+  size_t _busBytes( size_t bytesPerElement)
+  {
+    if( bytesPerElement == 4 && (_descriptor & (CSC_24BIT_SIGNED | CSC_24BIT_UNSIGNED)) != 0)
+    {
+      return( 3);
+    }
+    return( bytesPerElement);
+  }
+
+  // The memory location in an element for the n-th byte on the I2C bus.
+  // MSB is often the first byte in a sensor.
+  // However, the Arduino AVR family has the LSB at the lowest memory location.
+  // For 24-bit data, the fourth byte in memory is not on the I2C bus.
+  size_t _byteIndex( size_t n, size_t busBytes, size_t bytesPerElement)
+  {
+    size_t index = n;
+    if( (_descriptor & CSC_SENSOR_LSB_FIRST) == 0 && bytesPerElement > 1)
+    {
+      index = busBytes - 1 - n;        // MSB first, this is normal
+    }
+    if( !_littleEndian())
+    {
+      index = bytesPerElement - 1 - index;
+    }
+    return( index);
+  }
+
+  // Every I2C transaction of put() and get() ends here.
+  // The 'error' is the code of Wire.endTransmission(), zero for success.
+  // An error is counted, and the clock tuning uses it.
+  void _result( uint8_t error, bool pecError = false)
+  {
+    if( pecError)
+    {
+      _pecErrorCount++;
+    }
+    else if( error != 0)
+    {
+      _errorCount++;                        // increase the common error count
+    }
+
+#ifdef COMMONSENSORCLASS_CLOCK_TUNING
+    if( _clockTuning)
+    {
+      // A sensor that is busy does not acknowledge its I2C address,
+      // that has nothing to do with the clock.
+      if( error == CSC_I2C_ADDRESS_NACK && !pecError)
+      {
+        _clockNackCount++;
+      }
+      if( pecError || (error != 0 && error != CSC_I2C_ADDRESS_NACK) ||
+          _clockNackCount >= COMMONSENSORCLASS_CLOCK_NACK_COUNT)
+      {
+        // Go one step down and do not try a higher clock for a while.
+        if( _clockIndex > 0)
+        {
+          _clockIndex--;
+        }
+        _clockCeiling = _clockIndex;
+        _clockSuccess = 0;
+        _clockNackCount = 0;
+      }
+      else if( error == 0)
+      {
+        _clockNackCount = 0;
+        _clockSuccess++;
+        if( _clockIndex < _clockCeiling && _clockSuccess >= COMMONSENSORCLASS_CLOCK_STEP_COUNT)
+        {
+          _clockIndex++;                   // try the next higher clock
+          _clockSuccess = 0;
+        }
+        else if( _clockCeiling < _clockLimit && _clockSuccess >= COMMONSENSORCLASS_CLOCK_RETRY_COUNT)
+        {
+          _clockCeiling++;                 // try the clock again that gave an error
+          _clockIndex = _clockCeiling;
+          _clockSuccess = 0;
+        }
+      }
+      // The new clock is set at the start of the next put() or get().
+      _clock = _clockRate( _clockIndex);
+    }
+#endif
+  }
+
+#ifdef COMMONSENSORCLASS_CLOCK_TUNING
+  // The standard I2C clocks.
+  static uint8_t _clockRateCount()
+  {
+    return( 3);
+  }
+
+  static uint32_t _clockRate( uint8_t index)
+  {
+    return( index == 0 ? 100000UL : index == 1 ? 400000UL : 1000000UL);
+  }
+
+  // Set the clock of this sensor at the start of an I2C transfer.
+  // It is set every time, because another sensor on the same I2C bus,
+  // a Wire.begin() or the sketch could have changed the clock.
+  void _startClock()
+  {
+    if( _clock != 0)
+    {
+      _WireLib.setClock( _clock);
+    }
+  }
+#endif
+
+  // The CRC-8 for the SMBus PEC, with polynomial x^8 + x^2 + x + 1.
+  // A table of 16 bytes is used for 4 bits at a time,
+  // that is a good balance between speed and size.
+  static uint8_t _crc8( uint8_t crc, uint8_t data)
+  {
+    static const uint8_t table[16] CSC_PROGMEM =
+    {
+      0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+      0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+    };
+    crc ^= data;
+    crc = (uint8_t) (crc << 4) ^ CSC_READ_TABLE( &table[crc >> 4]);
+    crc = (uint8_t) (crc << 4) ^ CSC_READ_TABLE( &table[crc >> 4]);
+    return( crc);
+  }
+
+  // Write a byte with the Wire library, and add it to the PEC.
+  void _write( uint8_t data, uint8_t & crc)
+  {
+    _WireLib.write( data);
+    if( (_descriptor & CSC_SMBUS_PEC) != 0)
+    {
+      crc = _crc8( crc, data);
+    }
+  }
+
+  // The bytes of the register address, in the order of the I2C bus.
+  // return value: the number of bytes.
+  size_t _registerBytes( uint32_t registerAddress, uint8_t *bytes)
+  {
+    size_t n = _addressSize();
+    if( n == 1)
+    {
+      bytes[0] = (uint8_t) registerAddress;
+    }
+    else if( n == 2)
+    {
+      if( (_descriptor & CSC_SENSOR_LSB_FIRST) != 0)
+      {
+        // Is there a sensor with the register address LSB first ?
+        bytes[0] = (uint8_t) registerAddress;
+        bytes[1] = (uint8_t) (registerAddress >> 8);
+      }
+      else
+      {
+        // MSB is written first for most sensors.
+        bytes[0] = (uint8_t) (registerAddress >> 8);
+        bytes[1] = (uint8_t) registerAddress;
+      }
+    }
+    return( n);
+  }
+
+  // The PEC of the first part of a read transaction with a repeated start:
+  // the I2C address for writing and the register address.
+  uint8_t _pecWriteAddress( uint32_t registerAddress)
+  {
+    uint8_t bytes[2];
+    size_t n = _registerBytes( registerAddress, bytes);
+    uint8_t crc = _crc8( 0, (uint8_t) (_deviceAddress( registerAddress) << 1));
+    for( size_t i=0; i<n; i++)
+    {
+      crc = _crc8( crc, bytes[i]);
+    }
+    return( crc);
+  }
+
+  // The I2C address, with the block select bits for large I2C EEPROMs.
+  uint8_t _deviceAddress( uint32_t registerAddress)
+  {
+    uint8_t blockBits = (uint8_t) ((_descriptor & CSC_BLOCK_SELECT_MASK) >> 8);
+    if( blockBits == 0)
+    {
+      return( (uint8_t) _device_address);
+    }
+    uint8_t block = (uint8_t) (registerAddress >> 16) & ((1 << blockBits) - 1);
+    uint8_t shift = (_descriptor & CSC_BLOCK_SELECT_AT_BIT_2) != 0 ? 2 : 0;
+    return( (uint8_t) _device_address | (block << shift));
+  }
+
+  // The number of bytes until the next block or page boundary.
+  // Zero means that there is no boundary.
+  uint32_t _bytesToBoundary( uint32_t registerAddress, bool write)
+  {
+    uint32_t left = 0;
+    if( (_descriptor & CSC_BLOCK_SELECT_MASK) != 0)
+    {
+      left = 0x10000UL - (registerAddress & 0xFFFFUL);
+    }
+    if( write && _pageSize != 0)
+    {
+      uint32_t pageLeft = _pageSize - (registerAddress & (_pageSize - 1));
+      if( left == 0 || pageLeft < left)
+      {
+        left = pageLeft;
+      }
+    }
+    return( left);
+  }
+
+  // Clip the number of elements for the next part at a boundary.
+  // At least one element is transferred, in case an element crosses the boundary.
+  size_t _clipElements( size_t elements, uint32_t registerAddress, size_t busBytes, bool write)
+  {
+    uint32_t left = _bytesToBoundary( registerAddress, write);
+    if( left != 0)
+    {
+      // Compare as 32 bits, a size_t is 16 bits on the AVR and a block is 0x10000 bytes.
+      uint32_t maxElements = left / busBytes;
+      if( maxElements == 0)
+      {
+        maxElements = 1;
+      }
+      if( (uint32_t) elements > maxElements)
+      {
+        elements = (size_t) maxElements;
+      }
+    }
+    return( elements);
+  }
+
+  // Wait until an I2C EEPROM has finished writing.
+  // It does not acknowledge its I2C address while it is busy.
+  // A timeout is counted as an error.
+  // return value: true = ready, false = still busy after the timeout.
+  bool _waitForWrite( uint8_t deviceAddress)
+  {
+    unsigned long startMillis = COMMONSENSORCLASS_MILLIS();
+    while( true)
+    {
+      _WireLib.beginTransmission( deviceAddress);
+      if( _WireLib.endTransmission() == 0)
+      {
+        return( true);
+      }
+      if( COMMONSENSORCLASS_MILLIS() - startMillis > COMMONSENSORCLASS_WRITE_TIMEOUT)
+      {
+        _result( CSC_I2C_ADDRESS_NACK);    // still busy, not a problem with the clock
+        return( false);
+      }
+    }
+  }
+
+  // The code for put() with all the types.
+  // It is not a template, therefor there is only one copy of it.
+  // The 'ptr' may be NULL when 'size' is zero, then only the register address is written.
+  bool _put( uint32_t registerAddress, const uint8_t *ptr, size_t dataSize, size_t size, bool I2Cstop)
+  {
+    if( _descriptor == 0)                         // safety check if .begin() was called.
+    {
+      return( false);
+    }
+
+#ifdef COMMONSENSORCLASS_CLOCK_TUNING
+    _startClock();
+#endif
+    
+    bool success = true;           // default true, make it false if something fails later on.
+
+    size_t totalSize, bytesPerElement;
+    _sizes( dataSize, size, totalSize, bytesPerElement);
+    size_t busBytes = bytesPerElement;     // put() writes all the bytes, also for 24-bit data
+    size_t elements = totalSize / bytesPerElement;
+
+    // The register address is in the same buffer of the Wire library.
+    // Clip the bytes to transfer to a multiple of the element size.
+    // This is not a problem for the AVR Wire library which has a buffer of 32 bytes,
+    // but the TinyWire has only 18 bytes and the ATSAM has 255 bytes.
+    // The SMBus PEC is also in that buffer.
+    size_t pecBytes = ((_descriptor & CSC_SMBUS_PEC) != 0 && I2Cstop) ? 1 : 0;
+    size_t elementsPerChunk = (_bufferSize() - _addressSize() - pecBytes) / busBytes;
+    if( elementsPerChunk == 0)
+    {
+      elementsPerChunk = 1;
+    }
+
+    // If more data needs to be transmitted, then split it into seperate parts.
+    // Increase the registerAddress for each part.
+    // It is allowed to do one I2C bus transaction without data.
+    do
+    {
+      size_t elementsToTransfer = elements < elementsPerChunk ? elements : elementsPerChunk;
+      elementsToTransfer = _clipElements( elementsToTransfer, registerAddress, busBytes, true);
+      uint8_t deviceAddress = _deviceAddress( registerAddress);
+
+      _WireLib.beginTransmission( deviceAddress);
+      uint8_t crc = 0;
+      if( pecBytes != 0)
+      {
+        crc = _crc8( crc, (uint8_t) (deviceAddress << 1));
+      }
+
+      uint8_t addressBytes[2];
+      size_t addressSize = _registerBytes( registerAddress, addressBytes);
+      for( size_t i=0; i<addressSize; i++)
+      {
+        _write( addressBytes[i], crc);
+      }
+
+      for( size_t i=0; i<elementsToTransfer; i++)
+      {
+        for( size_t n=0; n<busBytes; n++)
+        {
+          _write( ptr[_byteIndex( n, busBytes, bytesPerElement)], crc);
+        }
+        ptr += bytesPerElement;
+      }
+
+      if( pecBytes != 0)
+      {
+        _WireLib.write( crc);
+      }
+
+      uint8_t error = _WireLib.endTransmission( I2Cstop);     // send true for a stop, false for repeated start.
+      _result( error);
+      if( error != 0)
+      {
+        success = false;                      // Some kind of I2C bus error, stop sending data.
+      }
+      else if( _pageSize != 0 && elementsToTransfer > 0)
+      {
+        success = _waitForWrite( deviceAddress);    // the next part fails while the EEPROM is busy
+      }
+
+      elements -= elementsToTransfer;
+      if( (_descriptor & CSC_NO_AUTO_INCREMENT) == 0)
+      {
+        registerAddress += elementsToTransfer * busBytes;
+      }
+    }
+    while( elements > 0 && success);
+    
+    return( success);              // return true if success, that means true if no error.
+  }
+
+  // The code for get() with all the types.
+  // It is not a template, therefor there is only one copy of it.
+  bool _get( uint32_t registerAddress, uint8_t *ptr, size_t dataSize, size_t size)
+  {
+    if( _descriptor == 0)                  // safety check if .begin() was not called.
+    {
+      return( false);
+    }
+
+#ifdef COMMONSENSORCLASS_CLOCK_TUNING
+    if( (_descriptor & CSC_NO_REGISTER_ADDRESS) != 0)
+    {
+      _startClock();               // else it is set by _put() for the register address
+    }
+#endif
+    
+    bool success = true;           // default true, make it false if something fails later on.
+
+    size_t totalSize, bytesPerElement;
+    _sizes( dataSize, size, totalSize, bytesPerElement);
+    size_t busBytes = _busBytes( bytesPerElement);
+    size_t elements = totalSize / bytesPerElement;
+
+    // Test if the sensor uses a register address.
+    // Some sensors (like the BH1750) don't have a register address in the sensor.
+    bool hasRegisterAddress = (_descriptor & CSC_NO_REGISTER_ADDRESS) == 0;
+    // A repeated start after setting the register address is the default.
+    bool stopI2C = (_descriptor & CSC_NO_REPEATED_START) != 0;
+    // With a repeated start, the PEC of the received data starts with the register address.
+    bool pec = (_descriptor & CSC_SMBUS_PEC) != 0;
+    uint8_t pecStart = 0;
+    if( hasRegisterAddress)
+    {
+      success = _put( registerAddress, NULL, 0, 0, stopI2C);
+      if( pec && !stopI2C)
+      {
+        pecStart = _pecWriteAddress( registerAddress);
+      }
+    }
+
+    // Clip the bytes to transfer to a multiple of the element size.
+    // The PEC is an extra byte in the buffer of the Wire library.
+    size_t pecBytes = pec ? 1 : 0;
+    size_t elementsPerChunk = (_bufferSize() - pecBytes) / busBytes;
+    if( elementsPerChunk == 0)
+    {
+      elementsPerChunk = 1;
+    }
+
+    // If more data is requested than the buffer size of the used Wire library,
+    // then split the request into seperate parts.
+    // This is no need to write the register address, 
+    // the Wire.requestFrom() is called multiple times.
+    // Only for a large I2C EEPROM, the register address is written again
+    // at the start of every block.
+    while( elements > 0 && success)
+    {
+      size_t elementsToTransfer = elements < elementsPerChunk ? elements : elementsPerChunk;
+      elementsToTransfer = _clipElements( elementsToTransfer, registerAddress, busBytes, false);
+      size_t bytesToTransfer = elementsToTransfer * busBytes;
+
+      uint8_t deviceAddress = _deviceAddress( registerAddress);
+      uint8_t crc = 0;
+      if( pec)
+      {
+        crc = _crc8( pecStart, (uint8_t) ((deviceAddress << 1) | 1));
+        pecStart = 0;                      // the next part has no register address
+      }
+
+      size_t n = (size_t) _WireLib.requestFrom( deviceAddress, (uint8_t) (bytesToTransfer + pecBytes));
+      if( n == bytesToTransfer + pecBytes)
+      {
+        // The right amount of bytes have been received, 
+        // That means that valid received bytes are in the buffer.
+        // Therefor it is no need to test every Wire.read for -1.
+        for( size_t i=0; i<elementsToTransfer; i++)
+        {
+          for( size_t b=0; b<busBytes; b++)
+          {
+            uint8_t data = (uint8_t) _WireLib.read();
+            if( pec)
+            {
+              crc = _crc8( crc, data);
+            }
+            ptr[_byteIndex( b, busBytes, bytesPerElement)] = data;
+          }
+
+          // Fill the MSB byte of a 24-bit value, extend the sign for signed data.
+          if( busBytes != bytesPerElement)
+          {
+            uint8_t msb = _littleEndian() ? ptr[2] : ptr[1];
+            uint8_t fill = ((_descriptor & CSC_24BIT_SIGNED) != 0 && (msb & 0x80) != 0) ? 0xFF : 0x00;
+            ptr[_littleEndian() ? 3 : 0] = fill;
+          }
+          ptr += bytesPerElement;
+        }
+        elements -= elementsToTransfer;
+
+        // The last byte is the PEC. When the PEC is wrong, the data
+        // is already stored, but false is returned.
+        if( pec && (uint8_t) _WireLib.read() != crc)
+        {
+          success = false;
+          _result( 0, true);
+        }
+        else
+        {
+          _result( 0);
+        }
+
+        uint32_t nextAddress = registerAddress;
+        if( (_descriptor & CSC_NO_AUTO_INCREMENT) == 0)
+        {
+          nextAddress += bytesToTransfer;
+        }
+        if( (_descriptor & CSC_BLOCK_SELECT_MASK) != 0 && hasRegisterAddress &&
+            (nextAddress >> 16) != (registerAddress >> 16) && elements > 0 && success)
+        {
+          success = _put( nextAddress, NULL, 0, 0, stopI2C);
+          if( pec && !stopI2C)
+          {
+            pecStart = _pecWriteAddress( nextAddress);
+          }
+        }
+        registerAddress = nextAddress;
+      }
+      else
+      {
+        // The Wire.requestFrom() failed.
+        success = false;
+        _result( CSC_I2C_OTHER_ERROR);
+      }
+    }
+    
+    return( success);
+  }
+
   T_WIRE_LIBRARY & _WireLib;      // The object by reference (from template) of the used Wire library
 
   // This data describes the sensor.
   int _device_address;            // The 7-bit (or 10-bit ?) I2C address of the sensor. Zero is allowed.
   uint32_t _descriptor;           // Describes the sensor. Zero means not initialized yet.
   uint16_t _errorCount;           // A two-byte integer should be enough. One error per day is already too much.
+  uint16_t _pecErrorCount;        // The number of times the PEC of the received data was wrong.
+  uint16_t _pageSize;             // The page size of an I2C EEPROM, zero for no pages.
+
+#ifdef COMMONSENSORCLASS_CLOCK_TUNING
+  uint32_t _clock;                // The I2C clock for this sensor, zero to not change it.
+  bool _clockTuning;              // The clock is tuned automatically.
+  uint8_t _clockIndex;            // The current standard clock.
+  uint8_t _clockCeiling;          // The highest standard clock that may be tried.
+  uint8_t _clockLimit;            // The highest standard clock of enableClockTuning().
+  uint16_t _clockSuccess;         // The good I2C transactions at the current clock.
+  uint8_t _clockNackCount;        // The number of times in a row without acknowledge of the I2C address.
+#endif
 };
 
 #endif
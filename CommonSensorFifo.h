@@ -0,0 +1,276 @@
+#ifndef COMMONSENSORFIFO_h
+#define COMMONSENSORFIFO_h
+
+// CommonSensorFifo
+// ----------------
+// Reading the hardware FIFO of a sensor with the CommonSensorClass.
+//
+// A sensor with a FIFO (for example the MPU-9250) stores the samples
+// in the FIFO, and has a register with the number of bytes in the FIFO
+// and a register to read the FIFO.
+// Reading the FIFO register does not increase the register address in the sensor,
+// every byte comes from the FIFO.
+//
+// The count register is read first, then only whole frames are read
+// from the FIFO register, in parts that are as large as the buffer of the Wire library.
+// A frame is the data of one sample, for example 12 bytes for accel and gyro.
+//
+// The FIFO can be read when it has reached a watermark (a number of bytes),
+// or after an interrupt of the sensor.
+// For the interrupt, call trigger() in the interrupt routine.
+// The I2C bus can not be used in the interrupt routine, the FIFO is read in poll().
+//
+// To test the watermark, poll() reads the count register.
+// Without a minimum time between those reads, a fast loop() keeps the I2C bus busy
+// with reading the count register. See setPollInterval().
+//
+// Example for the MPU-9250 with accel and gyro in the FIFO at 1kHz:
+//    fifo.begin( 0x72, CSC_FIFO_COUNT_SIZE_2, 0x1FFF, 0x74, 12, 512);
+//    fifo.setWatermark( 12 * 10);                 // read when 10 frames are in the FIFO
+//    fifo.setPollInterval( 5);                    // test the watermark every 5ms
+//    fifo.setOverflowRegister( 0x3A, 0x10);       // INT_STATUS, FIFO_OFLOW_INT
+//    ...
+//    size_t n = fifo.poll( buffer, sizeof( buffer));
+//
+// public domain
+
+
+#include "CommonSensorClass.h"
+
+
+// The time in milliseconds for setPollInterval().
+// It can be set before including this file, for another time source.
+#ifndef COMMONSENSORFIFO_MILLIS
+#define COMMONSENSORFIFO_MILLIS() COMMONSENSORCLASS_MILLIS()
+#endif
+
+// The count register.
+// A value of zero is not allowed, a count register has at least one byte.
+#define CSC_FIFO_COUNT_SIZE_1         0x01  // The count register is one byte.
+#define CSC_FIFO_COUNT_SIZE_2         0x02  // The count register is two bytes.
+#define CSC_FIFO_COUNT_LSB_FIRST      0x04  // The count register has the LSB first, the MSB first is the default.
+
+
+template <class T_WIRE_LIBRARY> class CommonSensorFifo
+{
+public:
+
+  // The "_Sensor" is the CommonSensorClass object of the sensor.
+  CommonSensorFifo( CommonSensorClass <T_WIRE_LIBRARY> & Sensor): _Sensor( Sensor)
+  {
+    _frameSize = 0;                  // zero means not initialized yet
+  }
+
+  // Describe the FIFO of the sensor.
+  void begin(
+    uint16_t countRegister,          // The register address of the count register.
+    uint8_t countFlags,              // A bitwise combination of the CSC_FIFO defines.
+    uint16_t countMask,              // The valid bits of the count register.
+    uint16_t dataRegister,           // The register address to read the FIFO.
+    uint16_t frameSize,              // The number of bytes of a sample in the FIFO.
+    uint16_t capacity)               // The size of the FIFO, a full FIFO has overflowed.
+  {
+    _countRegister = countRegister;
+    _countFlags = countFlags;
+    _countMask = countMask;
+    _dataRegister = dataRegister;
+    _frameSize = frameSize;
+    _capacity = capacity;
+    _watermark = 0;
+    _pollInterval = 0;
+    _overflowMask = 0;
+    _triggered = false;
+    _count = 0;
+    _overflowCount = 0;
+  }
+
+  // Read the FIFO with poll() when it has at least this number of bytes.
+  // Zero means that the FIFO is only read after trigger() (the default).
+  void setWatermark( uint16_t watermark)
+  {
+    _watermark = watermark;
+  }
+
+  // The minimum time in milliseconds between two reads of the count register by poll().
+  // Zero means that the count register is read for every poll() (the default).
+  // When the FIFO fills up in 10ms to the watermark, then 5ms is a good value.
+  // A poll() after trigger() does not wait for the interval.
+  void setPollInterval( unsigned long interval)
+  {
+    _pollInterval = interval;
+    _previousPoll = COMMONSENSORFIFO_MILLIS();
+  }
+
+  // A register of the sensor that tells that the FIFO has overflowed.
+  // It is read every time the FIFO is read.
+  // Some sensors clear the interrupt bits when that register is read.
+  void setOverflowRegister( uint16_t registerAddress, uint8_t mask)
+  {
+    _overflowRegister = registerAddress;
+    _overflowMask = mask;
+  }
+
+  // Call this from the interrupt routine of the interrupt of the sensor.
+  // The I2C bus is not used.
+  void trigger()
+  {
+    _triggered = true;
+  }
+
+  // Read the FIFO when the watermark is reached or after trigger().
+  // return value: the number of bytes that are stored in 'buffer', always whole frames.
+  size_t poll( uint8_t *buffer, size_t bufferSize)
+  {
+    if( _frameSize == 0)             // safety check if .begin() was called.
+    {
+      return( 0);
+    }
+
+    if( _triggered)
+    {
+      _triggered = false;
+      return( drain( buffer, bufferSize));
+    }
+
+    if( _watermark != 0)
+    {
+      if( _pollInterval != 0)
+      {
+        unsigned long currentMillis = COMMONSENSORFIFO_MILLIS();
+        if( currentMillis - _previousPoll < _pollInterval)
+        {
+          return( 0);                // too soon, the I2C bus is not used
+        }
+        _previousPoll = currentMillis;
+      }
+
+      int count = readCount();
+      if( count >= (int) _watermark)
+      {
+        return( _drain( (size_t) count, buffer, bufferSize));
+      }
+    }
+    return( 0);
+  }
+
+  // Read the FIFO now.
+  // return value: the number of bytes that are stored in 'buffer', always whole frames.
+  size_t drain( uint8_t *buffer, size_t bufferSize)
+  {
+    if( _frameSize == 0)             // safety check if .begin() was called.
+    {
+      return( 0);
+    }
+
+    int count = readCount();
+    if( count <= 0)
+    {
+      return( 0);
+    }
+    return( _drain( (size_t) count, buffer, bufferSize));
+  }
+
+  // Read the count register.
+  // return value: the number of bytes in the FIFO or -1 when it failed.
+  int readCount()
+  {
+    uint8_t bytes[2];
+    size_t size = (_countFlags & CSC_FIFO_COUNT_SIZE_2) != 0 ? 2 : 1;
+    if( !_Sensor.get( _countRegister, *bytes, size))
+    {
+      return( -1);
+    }
+
+    uint16_t count = bytes[0];
+    if( size == 2)
+    {
+      if( (_countFlags & CSC_FIFO_COUNT_LSB_FIRST) != 0)
+      {
+        count |= (uint16_t) bytes[1] << 8;
+      }
+      else
+      {
+        count = (count << 8) | bytes[1];
+      }
+    }
+    count &= _countMask;
+
+    _count = count;
+    if( count >= _capacity)
+    {
+      _overflowCount++;              // the FIFO is full, samples are lost
+    }
+    return( (int) count);
+  }
+
+  // The number of bytes in the FIFO, the last time the count register was read.
+  uint16_t getCount()
+  {
+    return( _count);
+  }
+
+  // The number of times that the FIFO was full or that the overflow bit was set.
+  // When the FIFO has overflowed, some sensors have half frames in the FIFO,
+  // then the FIFO should be reset.
+  uint16_t getOverflowCount()
+  {
+    return( _overflowCount);
+  }
+
+  void clearOverflowCount()
+  {
+    _overflowCount = 0;
+  }
+
+private:
+  size_t _drain( size_t count, uint8_t *buffer, size_t bufferSize)
+  {
+    // A full FIFO is already counted as an overflow by readCount().
+    if( _overflowMask != 0 && _count < _capacity)
+    {
+      int status = _Sensor.readByte( _overflowRegister);
+      if( status > 0 && (status & _overflowMask) != 0)
+      {
+        _overflowCount++;
+      }
+    }
+
+    // Only whole frames, a frame that is not complete stays in the FIFO.
+    if( count > bufferSize)
+    {
+      count = bufferSize;
+    }
+    size_t bytes = (count / _frameSize) * _frameSize;
+    if( bytes == 0)
+    {
+      return( 0);
+    }
+
+    // The register address is written once,
+    // the get() reads the data in parts as large as the buffer of the Wire library.
+    if( !_Sensor.get( _dataRegister, *buffer, bytes))
+    {
+      return( 0);
+    }
+    return( bytes);
+  }
+
+  CommonSensorClass <T_WIRE_LIBRARY> & _Sensor;   // The object by reference of the sensor
+
+  uint16_t _countRegister;        // The register address of the count register.
+  uint8_t _countFlags;            // The CSC_FIFO defines for the count register.
+  uint16_t _countMask;            // The valid bits of the count register.
+  uint16_t _dataRegister;         // The register address to read the FIFO.
+  uint16_t _frameSize;            // The size of a frame. Zero means not initialized yet.
+  uint16_t _capacity;             // The size of the FIFO.
+  uint16_t _watermark;            // Read the FIFO when it has this number of bytes, zero for not used.
+  unsigned long _pollInterval;    // The minimum time between two reads of the count register, zero for not used.
+  unsigned long _previousPoll;    // The last time that poll() has read the count register.
+  uint16_t _overflowRegister;     // The register address of the overflow bit.
+  uint8_t _overflowMask;          // The overflow bit, zero for not used.
+  volatile bool _triggered;       // Set by trigger() in an interrupt routine.
+  uint16_t _count;                // The last count.
+  uint16_t _overflowCount;        // The number of overflows.
+};
+
+#endif
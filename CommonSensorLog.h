@@ -0,0 +1,296 @@
+#ifndef COMMONSENSORLOG_h
+#define COMMONSENSORLOG_h
+
+// CommonSensorLog
+// ---------------
+// A compact binary log for the data that is read with the CommonSensorClass.
+//
+// Writing every sample with its full size wastes a lot of space on a SD card
+// or Flash memory. Sensor data does not change much from one sample to the next,
+// therefor only the difference with the previous sample is written.
+// The difference is written as a variable length integer, a small difference
+// takes only one byte.
+//
+// The log is written in blocks of a fixed size (512 bytes by default, that is
+// a sector of a SD card). Every block starts with a full sample (a keyframe),
+// so every block can be decoded on its own. That allows to jump to any position
+// in a large log file.
+//
+// The file layout:
+//    Block 0 is the file header:
+//      "CSCL", version, number of fields, block size (LSB first),
+//      one byte per field with the field code (CSC_LOG_U8, CSC_LOG_S16, ...).
+//      The rest of the block is filled with zeros.
+//    Block 1 and up contain the samples:
+//      0xC5, 0x5C                  sync bytes
+//      2 bytes                     number of bytes used in this block (LSB first)
+//      2 bytes                     number of samples in this block (LSB first)
+//      4 bytes                     number of the first sample in this block (LSB first)
+//      data                        the samples, the unused bytes are zero.
+//
+//    Every field of every sample is written as the difference with the same field
+//    of the previous sample. The first sample in a block is the difference with zero.
+//    The difference is calculated with the size of the field, sign extended,
+//    zigzag encoded (0, -1, 1, -2, 2 becomes 0, 1, 2, 3, 4) and then written
+//    as a LEB128 variable length integer (7 bits per byte, LSB first).
+//
+// The log can be read on a computer with the CommonSensorLogReader in the "extras" folder.
+//
+// The output can be any object with a write( const uint8_t *, size_t) function,
+// for example a File object of the SD library.
+//
+// The samples are given as a pointer to the data in memory,
+// just as it was filled by the CommonSensorClass get() function.
+// The fields should be packed, without padding bytes between them.
+// For example:
+//    int16_t imu[6];                             // 3 accel and 3 gyro values
+//    const uint8_t layout[6] = { CSC_LOG_S16, CSC_LOG_S16, CSC_LOG_S16,
+//                                CSC_LOG_S16, CSC_LOG_S16, CSC_LOG_S16 };
+//    logger.begin( layout, 6);
+//    sensor.get( 0x3B, imu);
+//    logger.add( imu);
+
+
+#include <inttypes.h>
+#include <string.h>
+
+
+#define COMMONSENSORLOG_VERSION 1
+
+
+// The field codes for the layout of a sample.
+// The lower bits are the number of bytes, the highest bit is set for signed data.
+// 24-bit data from the sensor is stored in a 4 byte variable by the CommonSensorClass,
+// use the 32-bit field codes for them.
+#define CSC_LOG_U8                  0x01
+#define CSC_LOG_S8                  0x81
+#define CSC_LOG_U16                 0x02
+#define CSC_LOG_S16                 0x82
+#define CSC_LOG_U32                 0x04
+#define CSC_LOG_S32                 0x84
+#define CSC_LOG_SIGNED              0x80
+#define CSC_LOG_SIZE_MASK           0x0F
+
+// The maximum number of fields in a sample.
+// It costs 4 bytes of RAM for each field.
+#ifndef COMMONSENSORLOG_MAX_FIELDS
+#define COMMONSENSORLOG_MAX_FIELDS  16
+#endif
+
+#define CSC_LOG_SYNC_1              0xC5
+#define CSC_LOG_SYNC_2              0x5C
+#define CSC_LOG_BLOCK_HEADER_SIZE   10
+
+
+template <class T_OUTPUT, size_t BLOCK_SIZE = 512> class CommonSensorLog
+{
+  // The block header has the number of used bytes and samples as 16 bits.
+  static_assert( BLOCK_SIZE <= 65535, "BLOCK_SIZE of the CommonSensorLog can not be more than 65535");
+
+public:
+
+  // The "_Output" is the object to write the blocks to.
+  CommonSensorLog( T_OUTPUT & Output): _Output( Output)
+  {
+    _fieldCount = 0;               // zero means not initialized yet
+  }
+
+  // The begin() function writes the file header.
+  // The layout is a list of field codes, one for every field in a sample.
+  // return value: true = success, false = invalid layout or write error.
+  bool begin( const uint8_t *layout, uint8_t fieldCount)
+  {
+    _fieldCount = 0;
+    _errorCount = 0;
+    _sampleCount = 0;
+
+    // The header must fit in the first block and every sample must fit in a block.
+    // A field of 4 bytes takes 5 bytes at most, when encoded.
+    if( fieldCount == 0 || fieldCount > COMMONSENSORLOG_MAX_FIELDS ||
+        (size_t) fieldCount + 8 > BLOCK_SIZE ||
+        (size_t) fieldCount * 5 + CSC_LOG_BLOCK_HEADER_SIZE > BLOCK_SIZE)
+    {
+      return( false);
+    }
+
+    _maxSampleSize = 0;
+    for( uint8_t i=0; i<fieldCount; i++)
+    {
+      uint8_t size = layout[i] & CSC_LOG_SIZE_MASK;
+      if( size != 1 && size != 2 && size != 4)
+      {
+        return( false);
+      }
+      _layout[i] = layout[i];
+      _maxSampleSize += (size == 4) ? 5 : (size == 2) ? 3 : 2;
+    }
+    _fieldCount = fieldCount;
+
+    memset( _block, 0, BLOCK_SIZE);
+    _block[0] = 'C';
+    _block[1] = 'S';
+    _block[2] = 'C';
+    _block[3] = 'L';
+    _block[4] = COMMONSENSORLOG_VERSION;
+    _block[5] = fieldCount;
+    _block[6] = (uint8_t) BLOCK_SIZE;
+    _block[7] = (uint8_t) (BLOCK_SIZE >> 8);
+    memcpy( &_block[8], _layout, fieldCount);
+
+    bool success = _writeBlock();
+    _startBlock();
+    return( success);
+  }
+
+  // The end() function writes the last block, when it has samples.
+  bool end()
+  {
+    bool success = flush();
+    _fieldCount = 0;
+    return( success);
+  }
+
+  // Add a sample to the log.
+  // A block is written to the output when it is full.
+  // return value: true = success, false = not initialized or write error.
+  bool add( const void *sample)
+  {
+    if( _fieldCount == 0)              // safety check if .begin() was called.
+    {
+      return( false);
+    }
+
+    bool success = true;
+
+    // Test if the sample fits in the block when it is encoded in the worst case.
+    // That is faster than encoding it first.
+    if( _used + _maxSampleSize > BLOCK_SIZE)
+    {
+      success = flush();
+    }
+
+    const uint8_t *ptr = (const uint8_t *) sample;
+    uint8_t *out = &_block[_used];
+
+    for( uint8_t i=0; i<_fieldCount; i++)
+    {
+      uint32_t value;
+      int32_t delta;
+      switch( _layout[i] & CSC_LOG_SIZE_MASK)
+      {
+        case 1:
+          value = *ptr++;
+          delta = (int8_t) (value - _previous[i]);
+          break;
+        case 2:
+          {                         // allow local variables with extra brackets
+            uint16_t data16;
+            memcpy( &data16, ptr, 2);
+            ptr += 2;
+            value = data16;
+            delta = (int16_t) (value - _previous[i]);
+          }
+          break;
+        default:
+          memcpy( &value, ptr, 4);
+          ptr += 4;
+          delta = (int32_t) (value - _previous[i]);
+          break;
+      }
+      _previous[i] = value;
+
+      // zigzag encoding, a small negative number becomes a small positive number.
+      uint32_t zigzag = ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31);
+
+      // LEB128, 7 bits per byte, the highest bit is set when more bytes follow.
+      while( zigzag >= 0x80)
+      {
+        *out++ = (uint8_t) zigzag | 0x80;
+        zigzag >>= 7;
+      }
+      *out++ = (uint8_t) zigzag;
+    }
+
+    _used = (size_t) (out - _block);
+    _blockSamples++;
+    _sampleCount++;
+
+    return( success);
+  }
+
+  // Write the current block, even if it is not full yet.
+  // The next sample starts a new block with a keyframe.
+  bool flush()
+  {
+    if( _fieldCount == 0 || _blockSamples == 0)
+    {
+      return( true);                // nothing to write
+    }
+
+    _block[0] = CSC_LOG_SYNC_1;
+    _block[1] = CSC_LOG_SYNC_2;
+    _block[2] = (uint8_t) _used;
+    _block[3] = (uint8_t) (_used >> 8);
+    _block[4] = (uint8_t) _blockSamples;
+    _block[5] = (uint8_t) (_blockSamples >> 8);
+    _block[6] = (uint8_t) _firstSample;
+    _block[7] = (uint8_t) (_firstSample >> 8);
+    _block[8] = (uint8_t) (_firstSample >> 16);
+    _block[9] = (uint8_t) (_firstSample >> 24);
+    memset( &_block[_used], 0, BLOCK_SIZE - _used);
+
+    bool success = _writeBlock();
+    _startBlock();
+    return( success);
+  }
+
+  uint32_t getSampleCount()
+  {
+    return( _sampleCount);
+  }
+
+  uint16_t getErrorCount()
+  {
+    return( _errorCount);
+  }
+
+  void clearErrorCount()
+  {
+    _errorCount = 0;
+  }
+
+private:
+  bool _writeBlock()
+  {
+    size_t n = _Output.write( _block, BLOCK_SIZE);
+    if( n != BLOCK_SIZE)
+    {
+      _errorCount++;                // increase the error count
+      return( false);
+    }
+    return( true);
+  }
+
+  void _startBlock()
+  {
+    _used = CSC_LOG_BLOCK_HEADER_SIZE;
+    _blockSamples = 0;
+    _firstSample = _sampleCount;
+    memset( _previous, 0, sizeof( _previous));   // the first sample is a keyframe
+  }
+
+  T_OUTPUT & _Output;             // The object by reference (from template) to write the log to
+
+  uint8_t _layout[COMMONSENSORLOG_MAX_FIELDS];     // The field codes of a sample
+  uint32_t _previous[COMMONSENSORLOG_MAX_FIELDS];  // The previous sample
+  uint8_t _fieldCount;            // Zero means not initialized yet.
+  size_t _maxSampleSize;          // The size of an encoded sample in the worst case
+  uint8_t _block[BLOCK_SIZE];     // The block that is being filled
+  size_t _used;                   // The number of bytes used in the block
+  uint16_t _blockSamples;         // The number of samples in the block
+  uint32_t _firstSample;          // The number of the first sample in the block
+  uint32_t _sampleCount;          // The total number of samples
+  uint16_t _errorCount;           // The number of failed writes
+};
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef COMMONSENSORTARGET_h
+#define COMMONSENSORTARGET_h
+
+// CommonSensorTarget
+// ------------------
+// The Slave (target) side for the CommonSensorClass.
+// An Arduino board behaves as a sensor with registers.
+//
+// The descriptor has the same meaning as for the CommonSensorClass:
+// the size of the register address, the LSB or MSB first and CSC_NO_AUTO_INCREMENT.
+// A put() in the sketch with a variable stores the bytes in the same order
+// as a sensor, so a get() with the CommonSensorClass returns the same variable.
+//
+// The registers are in memory twice (double buffered).
+// The sketch writes new values with put() in the second set of registers,
+// and makes them visible with publish().
+// The interrupt routine for onRequest only reads from the visible set,
+// so the sketch does not have to turn off the interrupts while it is writing the values.
+//
+// The data for one onRequest is always from the same publish().
+// That is up to COMMONSENSORCLASS_WIRE_BUFFER_SIZE bytes, the buffer of the Wire library.
+// A get() of more data is read in parts, and a publish() between two parts
+// gives old values in the first part and new values in the next part.
+// Keep the values that belong together within one part, for example
+// at a register address that is a multiple of the buffer size.
+//
+// The interrupt routines use the register address as the index in the memory.
+// That takes the same time for every register.
+//
+// The data that the Master writes is stored in both sets of registers.
+// The sketch should not write to those registers with put().
+// With onWrite() the sketch can get a function call when the Master has written data.
+//
+// Continuing to read without register address:
+//    The Wire library has to know all the data in the onRequest interrupt,
+//    but not how many bytes the Master will read.
+//    The register address is increased with the number of bytes that are given
+//    to the Wire library, that is the buffer size of the Wire library.
+//    The get() of the CommonSensorClass reads in parts of the same size,
+//    so that works, as long as COMMONSENSORCLASS_WIRE_BUFFER_SIZE is the same
+//    on both sides and the data is not 24-bit.
+//
+// There can only be one object of this class for every type of Wire library,
+// because the functions for onReceive and onRequest can not have a parameter.
+//
+// Example:
+//    CommonSensorTarget <TwoWire, 64> target( Wire);
+//    target.begin( 0x30);
+//    ...
+//    target.put( 0x10, temperature);
+//    target.put( 0x12, humidity);
+//    target.publish();
+//
+// public domain
+
+
+#include <string.h>
+#include "CommonSensorClass.h"
+
+
+template <class T_WIRE_LIBRARY, size_t MAP_SIZE = 256> class CommonSensorTarget
+{
+public:
+
+  // The function that is called after the Master has written data.
+  // It is called from the interrupt routine.
+  typedef void (*WriteFunction)( uint16_t registerAddress, size_t size);
+
+  CommonSensorTarget( T_WIRE_LIBRARY & WireLibrary): _WireLib( WireLibrary)
+  {
+    _descriptor = 0;                 // reset the descriptor
+    _writeFunction = NULL;
+    memset( _bank, 0, sizeof( _bank));
+    _front = 0;
+    _pointer = 0;
+  }
+
+  // The begin() function starts the I2C bus as a Slave (target) at an I2C address.
+  void begin(
+    int deviceAddress,               // The 7-bit I2C address of this board.
+    uint32_t descriptor = CSC_REGISTER_ADDRESS_SIZE_1)  // A bitwise combination of the CSC defines.
+  {
+    _descriptor = descriptor;
+    _pointer = 0;
+    _instance = this;
+
+    _WireLib.begin( (uint8_t) deviceAddress);
+    _WireLib.onReceive( _receiveEvent);
+    _WireLib.onRequest( _requestEvent);
+  }
+
+  void end()
+  {
+    _WireLib.end();
+    _descriptor = 0;
+  }
+
+  // Set the function that is called after the Master has written data.
+  void onWrite( WriteFunction function)
+  {
+    _writeFunction = function;
+  }
+
+  // Write a value in the registers, it is visible after publish().
+  // The bytes are stored just as a sensor would have them, so the
+  // CommonSensorClass get() with the same type returns the same value.
+  // return value: true = success, false = the registers are outside the memory.
+  template <typename T> bool put( uint16_t registerAddress, const T (&t), size_t size = sizeof( T))
+  {
+    return( _put( registerAddress, (const uint8_t *) &t, sizeof( T), size));
+  }
+
+  template <typename T, size_t N> bool put( uint16_t registerAddress, const T (&t)[N])
+  {
+    return( _put( registerAddress, (const uint8_t *) t, sizeof( t), sizeof( T)));
+  }
+
+  // Read a value from the visible registers, for example what the Master has written.
+  template <typename T> bool get( uint16_t registerAddress, T (&t), size_t size = sizeof( T))
+  {
+    return( _get( registerAddress, (uint8_t *) &t, sizeof( T), size));
+  }
+
+  template <typename T, size_t N> bool get( uint16_t registerAddress, T (&t)[N])
+  {
+    return( _get( registerAddress, (uint8_t *) t, sizeof( t), sizeof( T)));
+  }
+
+  // Make the new values visible for the Master.
+  // Only the index of the visible set is changed, that is a single byte.
+  // After that, the new set is copied to the other set, so put() can
+  // continue with the newest values.
+  void publish()
+  {
+    uint8_t back = 1 - _front;
+    _front = back;
+    memcpy( _bank[1 - back], _bank[back], MAP_SIZE);
+  }
+
+private:
+  // The size of the data and the size of the elements, the same as the CommonSensorClass.
+  // Only whole elements are used, the rest of the data is not in the registers.
+  static void _sizes( size_t dataSize, size_t size, size_t & totalSize, size_t & bytesPerElement)
+  {
+    totalSize = dataSize;
+    bytesPerElement = size;
+    if( totalSize == 1)
+    {
+      totalSize = size;
+      bytesPerElement = 1;
+    }
+    if( bytesPerElement != 2 && bytesPerElement != 4 && bytesPerElement != 8)
+    {
+      bytesPerElement = 1;
+    }
+    totalSize = (totalSize / bytesPerElement) * bytesPerElement;
+  }
+
+  // The memory location in an element for the n-th byte in the registers.
+  size_t _byteIndex( size_t n, size_t bytesPerElement)
+  {
+    size_t index = n;
+    if( (_descriptor & CSC_SENSOR_LSB_FIRST) == 0)
+    {
+      index = bytesPerElement - 1 - n;   // MSB first, this is normal
+    }
+#if defined( __BYTE_ORDER__) && defined( __ORDER_BIG_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    index = bytesPerElement - 1 - index;
+#endif
+    return( index);
+  }
+
+  bool _put( uint16_t registerAddress, const uint8_t *ptr, size_t dataSize, size_t size)
+  {
+    size_t totalSize, bytesPerElement;
+    _sizes( dataSize, size, totalSize, bytesPerElement);
+    if( (size_t) registerAddress + totalSize > MAP_SIZE)
+    {
+      return( false);
+    }
+
+    uint8_t *p = &_bank[1 - _front][registerAddress];
+    for( size_t i=0; i<totalSize; i+=bytesPerElement)
+    {
+      for( size_t n=0; n<bytesPerElement; n++)
+      {
+        *p++ = ptr[i + _byteIndex( n, bytesPerElement)];
+      }
+    }
+    return( true);
+  }
+
+  bool _get( uint16_t registerAddress, uint8_t *ptr, size_t dataSize, size_t size)
+  {
+    size_t totalSize, bytesPerElement;
+    _sizes( dataSize, size, totalSize, bytesPerElement);
+    if( (size_t) registerAddress + totalSize > MAP_SIZE)
+    {
+      return( false);
+    }
+
+    const uint8_t *p = &_bank[_front][registerAddress];
+    for( size_t i=0; i<totalSize; i+=bytesPerElement)
+    {
+      for( size_t n=0; n<bytesPerElement; n++)
+      {
+        ptr[i + _byteIndex( n, bytesPerElement)] = *p++;
+      }
+    }
+    return( true);
+  }
+
+  // The Master has written data.
+  // The first bytes are the register address, the rest is data for the registers.
+  static void _receiveEvent( int howMany)
+  {
+    CommonSensorTarget *t = _instance;
+    size_t addressSize = 0;
+    if( (t->_descriptor & CSC_NO_REGISTER_ADDRESS) == 0)
+    {
+      addressSize = (t->_descriptor & CSC_REGISTER_ADDRESS_SIZE_2) != 0 ? 2 : 1;
+    }
+
+    if( (size_t) howMany < addressSize)
+    {
+      while( t->_WireLib.available() > 0)      // not a valid register address
+      {
+        t->_WireLib.read();
+      }
+      return;
+    }
+
+    if( addressSize == 1)
+    {
+      t->_pointer = (uint8_t) t->_WireLib.read();
+    }
+    else if( addressSize == 2)
+    {
+      uint16_t first = (uint8_t) t->_WireLib.read();
+      uint16_t second = (uint8_t) t->_WireLib.read();
+      if( (t->_descriptor & CSC_SENSOR_LSB_FIRST) != 0)
+      {
+        t->_pointer = first | (second << 8);
+      }
+      else
+      {
+        t->_pointer = (first << 8) | second;
+      }
+    }
+    t->_pointer %= MAP_SIZE;
+
+    // The data is stored in both sets of registers.
+    uint16_t start = t->_pointer;
+    size_t size = (size_t) howMany - addressSize;
+    for( size_t i=0; i<size; i++)
+    {
+      uint8_t data = (uint8_t) t->_WireLib.read();
+      t->_bank[0][t->_pointer] = data;
+      t->_bank[1][t->_pointer] = data;
+      t->_increment( 1);
+    }
+
+    if( size > 0 && t->_writeFunction != NULL)
+    {
+      t->_writeFunction( start, size);
+    }
+  }
+
+  // The Master wants to read data.
+  // The data is given from the visible set of registers, starting at the register address.
+  // At the end of the memory, it continues at the start.
+  static void _requestEvent()
+  {
+    CommonSensorTarget *t = _instance;
+    const uint8_t *bank = t->_bank[t->_front];
+
+    size_t size = COMMONSENSORCLASS_WIRE_BUFFER_SIZE > MAP_SIZE ? MAP_SIZE : COMMONSENSORCLASS_WIRE_BUFFER_SIZE;
+    if( (t->_descriptor & CSC_NO_AUTO_INCREMENT) != 0)
+    {
+      // The same register over and over again, like a FIFO register.
+      for( size_t i=0; i<size; i++)
+      {
+        t->_WireLib.write( bank[t->_pointer]);
+      }
+      return;
+    }
+
+    size_t first = MAP_SIZE - t->_pointer;
+    if( first > size)
+    {
+      first = size;
+    }
+    t->_WireLib.write( &bank[t->_pointer], first);
+    if( first < size)
+    {
+      t->_WireLib.write( bank, size - first);
+    }
+    t->_increment( size);
+  }
+
+  void _increment( size_t n)
+  {
+    if( (_descriptor & CSC_NO_AUTO_INCREMENT) == 0)
+    {
+      _pointer = (uint16_t) ((_pointer + n) % MAP_SIZE);
+    }
+  }
+
+  T_WIRE_LIBRARY & _WireLib;      // The object by reference (from template) of the used Wire library
+
+  uint32_t _descriptor;           // Describes the registers. Zero means not initialized yet.
+  uint8_t _bank[2][MAP_SIZE];     // The two sets of registers.
+  volatile uint8_t _front;        // The set of registers that is visible for the Master.
+  volatile uint16_t _pointer;     // The register address for the next byte.
+  WriteFunction _writeFunction;   // Called after the Master has written data.
+
+  static CommonSensorTarget *_instance;    // For the interrupt routines.
+};
+
+template <class T_WIRE_LIBRARY, size_t MAP_SIZE> CommonSensorTarget<T_WIRE_LIBRARY, MAP_SIZE> *CommonSensorTarget<T_WIRE_LIBRARY, MAP_SIZE>::_instance = NULL;
+
+#endif
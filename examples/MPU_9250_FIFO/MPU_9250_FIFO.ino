@@ -0,0 +1,97 @@
+// Example sketch for the CommonSensorClass with the CommonSensorFifo
+// public domain.
+//
+// The MPU-9250 runs at 1kHz and stores the accel and gyro data in its FIFO.
+// A frame in the FIFO is 12 bytes: accel x,y,z and gyro x,y,z.
+// The FIFO is read when it has 10 frames or more.
+// The count register is read every 5ms to test that.
+// That is a few I2C transactions every 5ms, instead of two for every sample.
+
+// Using the default Arduino Wire library.
+// The Arduino Wire library uses the class "TwoWire",
+// and the object "Wire" is already created.
+#include <Wire.h>
+#include <CommonSensorClass.h>
+#include <CommonSensorFifo.h>
+CommonSensorClass <TwoWire> sensor( Wire);
+CommonSensorFifo <TwoWire> fifo( sensor);
+
+
+// Select which serial port is used
+#define SERIAL_PORT SerialUSB
+// #define SERIAL_PORT Serial
+
+
+#define FRAME_SIZE 12
+#define FRAMES_PER_READ 10
+#define POLL_INTERVAL 5              // milliseconds, half the time to fill the FIFO to the watermark
+
+uint8_t buffer[FRAME_SIZE * 20];     // room for more frames than the watermark
+unsigned long frames = 0;
+unsigned long previousMillis;
+
+
+void setup()
+{
+  SERIAL_PORT.begin( 115200);
+  while( !SERIAL_PORT);   // wait for Leonardo and Zero using native USB port.
+
+  SERIAL_PORT.println( "MPU-9250 FIFO");
+
+  sensor.begin( 0x68);            // Define the sensor. Just the address is sufficient for this sensor.
+  Wire.setClock( 400000);         // A faster I2C bus for the FIFO data, after the Wire.begin() in sensor.begin()
+
+  if( !sensor.exists())           // Check if sensor exists on the I2C bus.
+  {
+    SERIAL_PORT.println( "Error, sensor not found");
+  }
+  
+  sensor.writeByte( 0x6B, 0);     // PWR_MGMT_1, wakeup the sensor
+  sensor.writeByte( 0x1A, 0x01);  // CONFIG, low pass filter, 1kHz sample rate
+  sensor.writeByte( 0x19, 0);     // SMPLRT_DIV, 1kHz / (1 + 0)
+  sensor.writeByte( 0x6A, 0x04);  // USER_CTRL, reset the FIFO
+  sensor.writeByte( 0x23, 0x78);  // FIFO_EN, gyro x,y,z and accel in the FIFO
+  sensor.writeByte( 0x6A, 0x40);  // USER_CTRL, enable the FIFO
+
+  // The count register is 0x72 (FIFO_COUNTH), 13 bits, MSB first.
+  // The FIFO register is 0x74 (FIFO_R_W), and the FIFO is 512 bytes.
+  fifo.begin( 0x72, CSC_FIFO_COUNT_SIZE_2, 0x1FFF, 0x74, FRAME_SIZE, 512);
+  fifo.setWatermark( FRAME_SIZE * FRAMES_PER_READ);
+  fifo.setPollInterval( POLL_INTERVAL);
+  fifo.setOverflowRegister( 0x3A, 0x10);   // INT_STATUS, FIFO_OFLOW_INT
+
+  previousMillis = millis();
+}
+
+
+void loop()
+{
+  size_t n = fifo.poll( buffer, sizeof( buffer));
+  frames += n / FRAME_SIZE;
+
+  if( fifo.getOverflowCount() != 0)
+  {
+    SERIAL_PORT.println( "FIFO overflow, reset the FIFO");
+    sensor.writeByte( 0x6A, 0x04);     // USER_CTRL, reset the FIFO
+    sensor.writeByte( 0x6A, 0x40);     // USER_CTRL, enable the FIFO
+    fifo.clearOverflowCount();
+  }
+
+  if( millis() - previousMillis >= 1000)
+  {
+    previousMillis += 1000;
+
+    SERIAL_PORT.print( "samples per second = ");
+    SERIAL_PORT.print( frames);
+
+    // The last frame, the MPU-9250 has the MSB first.
+    if( n >= FRAME_SIZE)
+    {
+      const uint8_t *p = &buffer[n - FRAME_SIZE];
+      SERIAL_PORT.print( ", accel z = ");
+      SERIAL_PORT.print( (int16_t) ((p[4] << 8) | p[5]));
+    }
+    SERIAL_PORT.println();
+    frames = 0;
+  }
+}
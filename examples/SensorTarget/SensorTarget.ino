@@ -0,0 +1,70 @@
+// Example sketch for the CommonSensorTarget
+// public domain.
+//
+// This Arduino board behaves as a sensor at I2C address 0x30.
+// Another Arduino board can read it with the CommonSensorClass:
+//    sensor.begin( 0x30);
+//    uint32_t counter = sensor.readU32( 0x00);
+//    int16_t analog[2];                          // not 'int', that is 4 bytes on ARM and ESP boards
+//    sensor.get( 0x04, analog);
+//    sensor.writeByte( 0x10, 1);                 // turn on the led
+//
+// The registers:
+//    0x00  a counter, 4 bytes
+//    0x04  the values of A0 and A1, 2 bytes each
+//    0x10  the led, written by the Master
+
+
+// Using the default Arduino Wire library.
+// The Arduino Wire library uses the class "TwoWire",
+// and the object "Wire" is already created.
+#include <Wire.h>
+#include <CommonSensorTarget.h>
+CommonSensorTarget <TwoWire, 32> target( Wire);
+
+
+volatile bool ledChanged = false;
+
+// Called from the interrupt routine, keep it short.
+void written( uint16_t registerAddress, size_t size)
+{
+  if( registerAddress <= 0x10 && registerAddress + size > 0x10)
+  {
+    ledChanged = true;
+  }
+}
+
+
+void setup()
+{
+  pinMode( LED_BUILTIN, OUTPUT);
+
+  target.begin( 0x30);
+  target.onWrite( written);
+}
+
+
+void loop()
+{
+  static uint32_t counter = 0;
+
+  // The values are written together and the Master sees them after publish().
+  // An int16_t has the same size on every board, an int does not.
+  int16_t analog[2];
+  analog[0] = (int16_t) analogRead( A0);
+  analog[1] = (int16_t) analogRead( A1);
+  target.put( 0x00, counter);
+  target.put( 0x04, analog);
+  target.publish();
+  counter++;
+
+  if( ledChanged)
+  {
+    ledChanged = false;
+    uint8_t led;
+    target.get( 0x10, led);
+    digitalWrite( LED_BUILTIN, led != 0 ? HIGH : LOW);
+  }
+
+  delay( 10);
+}
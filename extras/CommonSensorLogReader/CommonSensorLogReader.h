@@ -0,0 +1,261 @@
+#ifndef COMMONSENSORLOGREADER_h
+#define COMMONSENSORLOGREADER_h
+
+// CommonSensorLogReader
+// ---------------------
+// Reads a log file that was written with the CommonSensorLog on a computer.
+// This is not for the Arduino, it is for a computer with a C++ compiler.
+//
+// The whole file is given as a block of memory.
+// Every block in the file can be decoded on its own, because the
+// first sample in a block is a keyframe.
+// The values of every sample are returned as int64_t, to fit both the
+// signed and the unsigned 32-bit fields.
+//
+// public domain
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../../CommonSensorLog.h"
+
+
+class CommonSensorLogReader
+{
+public:
+
+  CommonSensorLogReader()
+  {
+    _data = NULL;
+    _size = 0;
+    _fieldCount = 0;
+  }
+
+  // Parse the header of the file.
+  // The memory should stay valid as long as the reader is used.
+  // return value: true = success, false = not a valid log file.
+  bool open( const uint8_t *data, size_t size)
+  {
+    _fieldCount = 0;
+
+    if( size < 8 || memcmp( data, "CSCL", 4) != 0 || data[4] != COMMONSENSORLOG_VERSION)
+    {
+      return( false);
+    }
+
+    size_t blockSize = (size_t) data[6] | ((size_t) data[7] << 8);
+    uint8_t fieldCount = data[5];
+    if( blockSize < CSC_LOG_BLOCK_HEADER_SIZE || size < blockSize ||
+        fieldCount == 0 || (size_t) fieldCount + 8 > blockSize)
+    {
+      return( false);
+    }
+
+    for( uint8_t i=0; i<fieldCount; i++)
+    {
+      uint8_t size = data[8 + i] & CSC_LOG_SIZE_MASK;
+      if( size != 1 && size != 2 && size != 4)
+      {
+        return( false);
+      }
+      _layout[i] = data[8 + i];
+    }
+
+    _data = data;
+    _size = size;
+    _blockSize = blockSize;
+    _fieldCount = fieldCount;
+    return( true);
+  }
+
+  uint8_t getFieldCount()
+  {
+    return( _fieldCount);
+  }
+
+  uint8_t getFieldCode( uint8_t field)
+  {
+    return( _layout[field]);
+  }
+
+  size_t getBlockSize()
+  {
+    return( _blockSize);
+  }
+
+  // The number of blocks with samples, the header block is not counted.
+  // A block that is not complete at the end of the file is not counted.
+  size_t getBlockCount()
+  {
+    if( _fieldCount == 0)
+    {
+      return( 0);
+    }
+    return( (_size / _blockSize) - 1);
+  }
+
+  // The number of samples in a block, or zero when the block is not valid.
+  size_t getBlockSamples( size_t block)
+  {
+    const uint8_t *p = _blockPointer( block);
+    if( p == NULL)
+    {
+      return( 0);
+    }
+    return( (size_t) p[4] | ((size_t) p[5] << 8));
+  }
+
+  // The number of the first sample in a block.
+  uint32_t getBlockFirstSample( size_t block)
+  {
+    const uint8_t *p = _blockPointer( block);
+    if( p == NULL)
+    {
+      return( 0);
+    }
+    return( (uint32_t) p[6] | ((uint32_t) p[7] << 8) | ((uint32_t) p[8] << 16) | ((uint32_t) p[9] << 24));
+  }
+
+  // Find the block with a certain sample, for random access.
+  // The blocks are in order, a binary search is used.
+  // return value: the block or getBlockCount() when the sample is not in the file.
+  size_t findBlock( uint32_t sample)
+  {
+    size_t count = getBlockCount();
+    size_t low = 0;
+    size_t high = count;
+    while( low < high)
+    {
+      size_t middle = low + (high - low) / 2;
+      uint32_t first = getBlockFirstSample( middle);
+      if( sample < first)
+      {
+        high = middle;
+      }
+      else if( sample >= first + getBlockSamples( middle))
+      {
+        low = middle + 1;
+      }
+      else
+      {
+        return( middle);
+      }
+    }
+    return( count);
+  }
+
+  // Decode all the samples of a block.
+  // The 'values' should have room for getBlockSamples() * getFieldCount() values.
+  // return value: the number of decoded samples, or zero for an invalid block.
+  size_t decodeBlock( size_t block, int64_t *values)
+  {
+    const uint8_t *p = _blockPointer( block);
+    if( p == NULL)
+    {
+      return( 0);
+    }
+
+    size_t used = (size_t) p[2] | ((size_t) p[3] << 8);
+    size_t samples = (size_t) p[4] | ((size_t) p[5] << 8);
+    if( used < CSC_LOG_BLOCK_HEADER_SIZE || used > _blockSize)
+    {
+      return( 0);
+    }
+
+    const uint8_t *in = p + CSC_LOG_BLOCK_HEADER_SIZE;
+    const uint8_t *inEnd = p + used;
+
+    uint32_t previous[256];
+    memset( previous, 0, _fieldCount * sizeof( uint32_t));
+
+    for( size_t s=0; s<samples; s++)
+    {
+      for( uint8_t i=0; i<_fieldCount; i++)
+      {
+        // The encoded sample is never more than 5 bytes per field,
+        // but a damaged block could make the decoder read beyond the used bytes.
+        if( in >= inEnd)
+        {
+          return( s);
+        }
+
+        // Most differences are small, test for a single byte first.
+        uint32_t zigzag = *in++;
+        if( zigzag >= 0x80)
+        {
+          zigzag &= 0x7F;
+          unsigned int shift = 7;
+          uint8_t b;
+          do
+          {
+            if( in >= inEnd || shift > 28)
+            {
+              return( s);
+            }
+            b = *in++;
+            zigzag |= (uint32_t) (b & 0x7F) << shift;
+            shift += 7;
+          }
+          while( b >= 0x80);
+        }
+
+        uint32_t delta = (zigzag >> 1) ^ (0U - (zigzag & 1));
+        uint32_t value = previous[i] + delta;
+
+        uint8_t code = _layout[i];
+        switch( code)
+        {
+          case CSC_LOG_U8:
+            value &= 0xFF;
+            *values++ = (int64_t) value;
+            break;
+          case CSC_LOG_S8:
+            value &= 0xFF;
+            *values++ = (int64_t) (int8_t) value;
+            break;
+          case CSC_LOG_U16:
+            value &= 0xFFFF;
+            *values++ = (int64_t) value;
+            break;
+          case CSC_LOG_S16:
+            value &= 0xFFFF;
+            *values++ = (int64_t) (int16_t) value;
+            break;
+          case CSC_LOG_S32:
+            *values++ = (int64_t) (int32_t) value;
+            break;
+          default:
+            *values++ = (int64_t) value;
+            break;
+        }
+        previous[i] = value;
+      }
+    }
+    return( samples);
+  }
+
+private:
+  const uint8_t *_blockPointer( size_t block)
+  {
+    if( block >= getBlockCount())
+    {
+      return( NULL);
+    }
+    const uint8_t *p = _data + (block + 1) * _blockSize;
+    if( p[0] != CSC_LOG_SYNC_1 || p[1] != CSC_LOG_SYNC_2)
+    {
+      return( NULL);
+    }
+    return( p);
+  }
+
+  const uint8_t *_data;           // The whole file in memory
+  size_t _size;                   // The size of the file
+  size_t _blockSize;              // The size of a block
+  uint8_t _layout[256];           // The field codes of a sample
+  uint8_t _fieldCount;            // Zero means not opened yet.
+};
+
+#endif
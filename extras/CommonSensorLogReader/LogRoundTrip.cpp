@@ -0,0 +1,212 @@
+// LogRoundTrip
+// ------------
+// Test for the CommonSensorLog and the CommonSensorLogReader on a computer.
+// This is not for the Arduino.
+//
+// Samples with all the field types are written to a log in memory,
+// then the log is decoded and compared with the samples.
+// The values are a mix of small and large changes, wrap-arounds and
+// the minimum and maximum values.
+//
+// Compile:
+//    g++ -O2 -o LogRoundTrip LogRoundTrip.cpp
+//
+// Use:
+//    LogRoundTrip [samples]             the default is 1000000 samples
+//
+// public domain
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "CommonSensorLogReader.h"
+
+
+// The log is written to memory.
+class VectorOutput
+{
+public:
+  size_t write( const uint8_t *pData, size_t length)
+  {
+    data.insert( data.end(), pData, pData + length);
+    return( length);
+  }
+  std::vector<uint8_t> data;
+};
+
+
+#define FIELDS 6
+
+static const uint8_t layout[FIELDS] =
+{
+  CSC_LOG_U8, CSC_LOG_S8, CSC_LOG_U16, CSC_LOG_S16, CSC_LOG_U32, CSC_LOG_S32
+};
+
+// The sample as it is in memory, packed without padding bytes.
+struct __attribute__(( packed)) Sample
+{
+  uint8_t u8;
+  int8_t s8;
+  uint16_t u16;
+  int16_t s16;
+  uint32_t u32;
+  int32_t s32;
+};
+
+
+// A simple random generator, to get the same test every time.
+static uint32_t randomState = 12345;
+
+static uint32_t nextRandom()
+{
+  randomState = randomState * 1664525UL + 1013904223UL;
+  return( randomState);
+}
+
+static void makeSample( uint32_t i, Sample & s)
+{
+  uint32_t r = nextRandom();
+  switch( i % 4)
+  {
+    case 0:                          // small changes
+      s.u8 += (uint8_t) (r & 3);
+      s.s8 -= (int8_t) ((r >> 2) & 3);
+      s.u16 += (uint16_t) ((r >> 4) & 15);
+      s.s16 -= (int16_t) ((r >> 8) & 15);
+      s.u32 += (r >> 12) & 255;
+      s.s32 = (int32_t) ((uint32_t) s.s32 - ((r >> 20) & 255));
+      break;
+    case 1:                          // anything
+      s.u8 = (uint8_t) r;
+      s.s8 = (int8_t) (r >> 8);
+      s.u16 = (uint16_t) (r >> 3);
+      s.s16 = (int16_t) (r >> 13);
+      s.u32 = nextRandom();
+      s.s32 = (int32_t) nextRandom();
+      break;
+    case 2:                          // the extremes
+      s.u8 = (r & 1) ? 0 : 255;
+      s.s8 = (r & 2) ? -128 : 127;
+      s.u16 = (r & 4) ? 0 : 65535;
+      s.s16 = (r & 8) ? -32768 : 32767;
+      s.u32 = (r & 16) ? 0 : 0xFFFFFFFFUL;
+      s.s32 = (r & 32) ? INT32_MIN : INT32_MAX;
+      break;
+    default:                         // no change
+      break;
+  }
+}
+
+static void sampleValues( const Sample & s, int64_t *v)
+{
+  v[0] = s.u8;
+  v[1] = s.s8;
+  v[2] = s.u16;
+  v[3] = s.s16;
+  v[4] = s.u32;
+  v[5] = s.s32;
+}
+
+
+int main( int argc, char *argv[])
+{
+  uint32_t count = 1000000UL;
+  if( argc > 1)
+  {
+    count = (uint32_t) strtoul( argv[1], NULL, 0);
+  }
+
+  VectorOutput output;
+  CommonSensorLog <VectorOutput> logger( output);
+  if( !logger.begin( layout, FIELDS))
+  {
+    printf( "FAIL: begin()\n");
+    return( 1);
+  }
+
+  Sample s;
+  memset( &s, 0, sizeof( s));
+  for( uint32_t i=0; i<count; i++)
+  {
+    makeSample( i, s);
+    if( !logger.add( &s))
+    {
+      printf( "FAIL: add() at sample %u\n", i);
+      return( 1);
+    }
+  }
+  if( !logger.end() || logger.getErrorCount() != 0)
+  {
+    printf( "FAIL: end()\n");
+    return( 1);
+  }
+
+  CommonSensorLogReader reader;
+  if( !reader.open( output.data.data(), output.data.size()))
+  {
+    printf( "FAIL: open()\n");
+    return( 1);
+  }
+
+  // Decode every block and compare it with the same samples again.
+  randomState = 12345;
+  memset( &s, 0, sizeof( s));
+  std::vector<int64_t> values( reader.getBlockSize() * FIELDS);
+  int64_t expected[FIELDS];
+  uint32_t sample = 0;
+  auto start = std::chrono::steady_clock::now();
+  for( size_t b=0; b<reader.getBlockCount(); b++)
+  {
+    if( reader.getBlockFirstSample( b) != sample)
+    {
+      printf( "FAIL: block %zu starts at sample %u, expected %u\n", b, reader.getBlockFirstSample( b), sample);
+      return( 1);
+    }
+    size_t n = reader.decodeBlock( b, values.data());
+    if( n == 0 || n != reader.getBlockSamples( b))
+    {
+      printf( "FAIL: block %zu can not be decoded\n", b);
+      return( 1);
+    }
+    for( size_t i=0; i<n; i++, sample++)
+    {
+      makeSample( sample, s);
+      sampleValues( s, expected);
+      if( memcmp( expected, &values[i * FIELDS], sizeof( expected)) != 0)
+      {
+        printf( "FAIL: sample %u is different\n", sample);
+        return( 1);
+      }
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  if( sample != count)
+  {
+    printf( "FAIL: %u samples decoded, expected %u\n", sample, count);
+    return( 1);
+  }
+
+  // Random access to a sample in the middle.
+  if( count > 0)
+  {
+    size_t b = reader.findBlock( count / 2);
+    uint32_t first = reader.getBlockFirstSample( b);
+    if( b >= reader.getBlockCount() || first > count / 2 || first + reader.getBlockSamples( b) <= count / 2)
+    {
+      printf( "FAIL: findBlock()\n");
+      return( 1);
+    }
+  }
+
+  double seconds = std::chrono::duration<double>( stop - start).count();
+  printf( "ok: %u samples, %zu bytes (%.2f bytes per sample)\n",
+          count, output.data.size(), count > 0 ? (double) output.data.size() / count : 0.0);
+  printf( "decode and compare: %.1f MB/s\n", seconds > 0.0 ? (double) output.data.size() / 1.0E6 / seconds : 0.0);
+  return( 0);
+}
@@ -0,0 +1,129 @@
+// csclog
+// ------
+// Prints a log file of the CommonSensorLog as text with comma separated values.
+// This is not for the Arduino, it is for a computer with a C++ compiler.
+//
+// Compile:
+//    g++ -O2 -o csclog csclog.cpp
+//
+// Use:
+//    csclog logfile.bin                 print all samples
+//    csclog -s 1000 logfile.bin         print from sample 1000 and up
+//    csclog -b logfile.bin              decode everything and print the speed
+//
+// public domain
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <chrono>
+#include <vector>
+
+#include "CommonSensorLogReader.h"
+
+
+static bool readFile( const char *name, std::vector<uint8_t> &data)
+{
+  FILE *f = fopen( name, "rb");
+  if( f == NULL)
+  {
+    return( false);
+  }
+  fseek( f, 0, SEEK_END);
+  long size = ftell( f);
+  fseek( f, 0, SEEK_SET);
+  data.resize( size > 0 ? (size_t) size : 0);
+  size_t n = fread( data.data(), 1, data.size(), f);
+  fclose( f);
+  return( n == data.size());
+}
+
+
+int main( int argc, char *argv[])
+{
+  bool benchmark = false;
+  uint32_t startSample = 0;
+  const char *name = NULL;
+
+  for( int i=1; i<argc; i++)
+  {
+    if( strcmp( argv[i], "-b") == 0)
+    {
+      benchmark = true;
+    }
+    else if( strcmp( argv[i], "-s") == 0 && i + 1 < argc)
+    {
+      startSample = (uint32_t) strtoul( argv[++i], NULL, 0);
+    }
+    else
+    {
+      name = argv[i];
+    }
+  }
+
+  if( name == NULL)
+  {
+    fprintf( stderr, "Use: csclog [-b] [-s sample] logfile\n");
+    return( 1);
+  }
+
+  std::vector<uint8_t> data;
+  if( !readFile( name, data))
+  {
+    fprintf( stderr, "Error, can not read %s\n", name);
+    return( 1);
+  }
+
+  CommonSensorLogReader reader;
+  if( !reader.open( data.data(), data.size()))
+  {
+    fprintf( stderr, "Error, %s is not a CommonSensorLog file\n", name);
+    return( 1);
+  }
+
+  size_t fields = reader.getFieldCount();
+  size_t blocks = reader.getBlockCount();
+
+  // A block can not have more samples than bytes, every field takes at least one byte.
+  std::vector<int64_t> values( reader.getBlockSize() * fields);
+
+  if( benchmark)
+  {
+    uint64_t samples = 0;
+    auto start = std::chrono::steady_clock::now();
+    for( size_t b=0; b<blocks; b++)
+    {
+      samples += reader.decodeBlock( b, values.data());
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>( stop - start).count();
+    double megabytes = (double) (blocks * reader.getBlockSize()) / 1.0E6;
+    printf( "%" PRIu64 " samples in %zu blocks, %.3f ms, %.1f MB/s\n",
+            samples, blocks, seconds * 1000.0, seconds > 0.0 ? megabytes / seconds : 0.0);
+    return( 0);
+  }
+
+  for( size_t b=reader.findBlock( startSample); b<blocks; b++)
+  {
+    size_t n = reader.decodeBlock( b, values.data());
+    uint32_t sample = reader.getBlockFirstSample( b);
+    const int64_t *v = values.data();
+    for( size_t s=0; s<n; s++, sample++, v+=fields)
+    {
+      if( sample < startSample)
+      {
+        continue;
+      }
+      printf( "%" PRIu32, sample);
+      for( size_t i=0; i<fields; i++)
+      {
+        printf( ",%" PRId64, v[i]);
+      }
+      printf( "\n");
+    }
+  }
+
+  return( 0);
+}
@@ -0,0 +1,244 @@
+// EepromLoopback
+// --------------
+// Test for a large I2C EEPROM with the CommonSensorClass on a Linux computer.
+// This is not for the Arduino.
+//
+// A simulated I2C bus has a 24M02 EEPROM (256 kbyte) with two block select bits
+// in the I2C address, just like the SimulateEEPROM example simulates an I2C EEPROM.
+// Writing wraps around inside a page of 256 bytes, reading wraps around inside a block.
+// After writing, the EEPROM does not acknowledge its I2C address for 5ms.
+// The time is simulated, every byte on the I2C bus takes 25us.
+//
+// Compile:
+//    g++ -O2 -I../.. -o EepromLoopback EepromLoopback.cpp
+//
+// public domain
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// The simulated time for the write timeout.
+static unsigned long simMicros = 0;
+#define COMMONSENSORCLASS_MILLIS() (simMicros / 1000UL)
+
+#include "CommonSensorClass.h"
+
+
+#define EEPROM_ADDRESS   0x50
+#define EEPROM_SIZE      0x40000UL
+#define PAGE_SIZE        256
+#define WRITE_TIME       5000UL      // microseconds
+#define BYTE_TIME        25UL        // microseconds, about 400kHz
+
+
+// A simulated I2C bus with a 24M02 EEPROM.
+// The block select bits are the lowest two bits of the I2C address.
+class SimEepromWire
+{
+public:
+  SimEepromWire()
+  {
+    memset( memory, 0xFF, sizeof( memory));
+    _pointer = 0;
+    _readyMicros = 0;
+    stuck = false;
+    writes = 0;
+    transactions = 0;
+  }
+
+  void begin( void) {}
+  void end( void) {}
+  void beginTransmission( uint8_t address)
+  {
+    _address = address;
+    _txLength = 0;
+  }
+  size_t write( uint8_t data)
+  {
+    if( _txLength >= sizeof( _txBuffer))
+    {
+      return( 0);
+    }
+    _txBuffer[_txLength++] = data;
+    return( 1);
+  }
+  uint8_t endTransmission( bool stop = true)
+  {
+    (void) stop;
+    simMicros += (_txLength + 1) * BYTE_TIME;
+    if( !_ready())
+    {
+      return( 2);                    // busy writing, no acknowledge of the I2C address
+    }
+    transactions++;
+    if( _txLength >= 2)
+    {
+      _pointer = _block() | ((uint32_t) _txBuffer[0] << 8) | _txBuffer[1];
+    }
+    if( _txLength > 2)
+    {
+      // The data is written in the page, at the end of the page it continues at the start.
+      for( size_t i=2; i<_txLength; i++)
+      {
+        memory[_pointer] = _txBuffer[i];
+        _pointer = (_pointer & ~(uint32_t) (PAGE_SIZE - 1)) | ((_pointer + 1) & (PAGE_SIZE - 1));
+      }
+      _readyMicros = stuck ? (unsigned long) -1 : simMicros + WRITE_TIME;
+      writes++;
+    }
+    return( 0);
+  }
+  uint8_t requestFrom( uint8_t address, uint8_t length)
+  {
+    _address = address;
+    simMicros += (length + 1) * BYTE_TIME;
+    if( !_ready())
+    {
+      return( 0);
+    }
+    if( _block() != (_pointer & 0x30000UL))
+    {
+      printf( "      the block select bits do not match the register address\n");
+      return( 0);
+    }
+    transactions++;
+    return( length);
+  }
+  int read( void)
+  {
+    // Reading continues in the same block.
+    int data = memory[_pointer];
+    _pointer = (_pointer & 0x30000UL) | ((_pointer + 1) & 0xFFFFUL);
+    return( data);
+  }
+
+  // Finish the write that is stuck.
+  void release()
+  {
+    stuck = false;
+    _readyMicros = 0;
+  }
+
+  uint8_t memory[EEPROM_SIZE];
+  bool stuck;                        // the EEPROM does not finish the next write
+  unsigned long writes;              // the number of I2C transactions that write data
+  unsigned long transactions;        // the number of acknowledged I2C transactions
+
+private:
+  bool _ready()
+  {
+    return( (_address & ~0x03) == EEPROM_ADDRESS && simMicros >= _readyMicros);
+  }
+  uint32_t _block()
+  {
+    return( (uint32_t) (_address & 0x03) << 16);
+  }
+
+  uint8_t _address;
+  uint8_t _txBuffer[COMMONSENSORCLASS_WIRE_BUFFER_SIZE];
+  size_t _txLength;
+  uint32_t _pointer;
+  unsigned long _readyMicros;
+};
+
+
+static int failures = 0;
+
+static void check( bool ok, const char *text)
+{
+  printf( "%s: %s\n", ok ? "ok  " : "FAIL", text);
+  if( !ok)
+  {
+    failures++;
+  }
+}
+
+
+static SimEepromWire bus;
+static uint8_t data[4096];
+static uint8_t readBack[4096];
+
+static void fill( size_t size, uint8_t seed)
+{
+  for( size_t i=0; i<size; i++)
+  {
+    data[i] = (uint8_t) (i * 7 + seed + (i >> 8));
+  }
+}
+
+
+int main()
+{
+  CommonSensorClass <SimEepromWire> eeprom( bus);
+  eeprom.begin( EEPROM_ADDRESS, CSC_REGISTER_ADDRESS_SIZE_2 | CSC_BLOCK_SELECT_2_BITS);
+  eeprom.setPageSize( PAGE_SIZE);
+
+  // Writing across the first block boundary.
+  // 30 bytes fit in the buffer with the register address:
+  // 128 bytes to the boundary are 5 parts, and 128 bytes after it are 5 parts.
+  fill( 256, 1);
+  bus.writes = 0;
+  bool ok = eeprom.writeStream( 0x0FF80UL, data, 256);
+  check( ok && memcmp( &bus.memory[0x0FF80UL], data, 256) == 0, "writeStream() across 0x0FFFF to 0x10000");
+  check( bus.memory[0x0FF7FUL] == 0xFF && bus.memory[0x10080UL] == 0xFF, "nothing written outside the data");
+  printf( "      %lu write transactions\n", bus.writes);
+  check( bus.writes == 10, "10 write transactions, split at the page and the block");
+
+  // Reading across the first block boundary.
+  // The register address is written again at 0x10000.
+  bus.transactions = 0;
+  ok = eeprom.readStream( 0x0FF80UL, readBack, 256);
+  check( ok && memcmp( readBack, data, 256) == 0, "readStream() across 0x0FFFF to 0x10000");
+  check( bus.transactions == 2 + 4 + 4, "two register addresses and 8 reads of 32 bytes");
+
+  // A read from the start of a block is not split.
+  bus.transactions = 0;
+  ok = eeprom.readStream( 0x10000UL, readBack, 128);
+  check( ok && memcmp( readBack, &data[128], 128) == 0 && bus.transactions == 1 + 4, "readStream() from the start of a block");
+
+  // A large read that starts just before a block boundary.
+  bus.transactions = 0;
+  ok = eeprom.readStream( 0x0FFF0UL, readBack, 4096);
+  printf( "      %lu transactions for 4096 bytes\n", bus.transactions);
+  check( ok && bus.transactions == 131, "4096 bytes in 131 transactions");
+
+  // The last block boundary.
+  fill( 4096, 2);
+  ok = eeprom.writeStream( 0x2F900UL, data, 4096);
+  memset( readBack, 0, sizeof( readBack));
+  ok = eeprom.readStream( 0x2F900UL, readBack, 4096) && ok;
+  check( ok && memcmp( readBack, data, 4096) == 0, "4096 bytes across 0x2FFFF to 0x30000");
+
+  // A write that does not start at a page boundary is split at the page.
+  fill( 100, 3);
+  bus.writes = 0;
+  ok = eeprom.writeStream( 0x123D0UL, data, 100);
+  check( ok && memcmp( &bus.memory[0x123D0UL], data, 100) == 0 && bus.memory[0x12300UL] == 0xFF,
+         "no page wrap with setPageSize()");
+  check( bus.writes == 2 + 2, "split at the page boundary");
+
+  // Without the page size, the EEPROM wraps around inside the page.
+  eeprom.setPageSize( 0);
+  fill( 30, 4);
+  eeprom.writeStream( 0x201F0UL, data, 30);
+  simMicros += WRITE_TIME;
+  check( memcmp( &bus.memory[0x201F0UL], data, 16) == 0 && memcmp( &bus.memory[0x20100UL], &data[16], 14) == 0,
+         "page wrap without setPageSize()");
+  eeprom.setPageSize( PAGE_SIZE);
+
+  // An EEPROM that stays busy.
+  eeprom.clearErrorCount();
+  bus.stuck = true;
+  bus.writes = 0;
+  unsigned long startMicros = simMicros;
+  ok = eeprom.writeStream( 0x00100UL, data, 60);
+  unsigned long waited = (simMicros - startMicros) / 1000UL;
+  bus.release();
+  check( !ok && eeprom.getErrorCount() == 1 && bus.writes == 1, "a write timeout fails, is counted and stops the put()");
+  check( waited >= COMMONSENSORCLASS_WRITE_TIMEOUT && waited <= COMMONSENSORCLASS_WRITE_TIMEOUT + 2, "the timeout is a time");
+
+  printf( "%d failure(s)\n", failures);
+  return( failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,276 @@
+// FifoLoopback
+// ------------
+// Test for the CommonSensorFifo on a Linux computer.
+// This is not for the Arduino.
+//
+// A simulated I2C bus has a sensor with a FIFO, like the MPU-9250:
+// a two byte count register, a FIFO register and an interrupt status
+// register with an overflow bit.
+// The bytes in the FIFO are a counter, so every byte that is lost or
+// read twice is noticed.
+//
+// Compile:
+//    g++ -O2 -I../.. -o FifoLoopback FifoLoopback.cpp
+//
+// public domain
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// A simulated time for setPollInterval().
+static unsigned long simMillis = 0;
+#define COMMONSENSORFIFO_MILLIS() simMillis
+
+#include "CommonSensorClass.h"
+#include "CommonSensorFifo.h"
+
+
+#define COUNT_REGISTER   0x72
+#define FIFO_REGISTER    0x74
+#define STATUS_REGISTER  0x3A
+#define OVERFLOW_BIT     0x10
+#define FIFO_SIZE        512
+#define FRAME_SIZE       12
+
+
+// A simulated I2C bus with a sensor with a FIFO.
+// The register address increases after every byte, except for the FIFO register.
+// The overflow bit is cleared when the status register is read.
+class SimFifoWire
+{
+public:
+  SimFifoWire()
+  {
+    _count = 0;
+    _next = 0;
+    _status = 0;
+    transactions = 0;
+  }
+
+  // The sensor stores new bytes in the FIFO.
+  // When the FIFO is full, the new bytes are lost.
+  void push( size_t n)
+  {
+    for( size_t i=0; i<n; i++)
+    {
+      if( _count < FIFO_SIZE)
+      {
+        _fifo[(_first + _count) % FIFO_SIZE] = _next;
+        _count++;
+      }
+      else
+      {
+        _status |= OVERFLOW_BIT;
+      }
+      _next++;
+    }
+  }
+
+  // Remove everything from the FIFO, the next byte continues the counter.
+  void reset( uint8_t next)
+  {
+    _count = 0;
+    _first = 0;
+    _next = next;
+    _status = 0;
+  }
+
+  size_t fifoCount()
+  {
+    return( _count);
+  }
+
+  void begin( void) {}
+  void end( void) {}
+  void beginTransmission( uint8_t address)
+  {
+    (void) address;
+    _index = 0;
+  }
+  size_t write( uint8_t data)
+  {
+    if( _index == 0)
+    {
+      _register = data;
+    }
+    _index++;
+    return( 1);
+  }
+  uint8_t endTransmission( bool stop = true)
+  {
+    (void) stop;
+    transactions++;
+    return( 0);
+  }
+  uint8_t requestFrom( uint8_t address, uint8_t length)
+  {
+    (void) address;
+    transactions++;
+    return( length);
+  }
+  int read( void)
+  {
+    int data = 0;
+    switch( _register)
+    {
+      case COUNT_REGISTER:
+        data = (int) (_count >> 8);
+        break;
+      case COUNT_REGISTER + 1:
+        data = (int) (_count & 0xFF);
+        break;
+      case STATUS_REGISTER:
+        data = _status;
+        _status = 0;
+        break;
+      case FIFO_REGISTER:
+        if( _count > 0)
+        {
+          data = _fifo[_first];
+          _first = (_first + 1) % FIFO_SIZE;
+          _count--;
+        }
+        return( data);               // the register address stays the same
+    }
+    _register++;
+    return( data);
+  }
+
+  unsigned long transactions;
+
+private:
+  uint8_t _fifo[FIFO_SIZE];
+  size_t _first;
+  size_t _count;
+  uint8_t _next;
+  uint8_t _status;
+  uint8_t _register;
+  size_t _index;
+};
+
+
+static int failures = 0;
+
+static void check( bool ok, const char *text)
+{
+  printf( "%s: %s\n", ok ? "ok  " : "FAIL", text);
+  if( !ok)
+  {
+    failures++;
+  }
+}
+
+// Test that the bytes continue the counter.
+static uint8_t expected = 0;
+
+static bool sequence( const uint8_t *buffer, size_t n)
+{
+  bool ok = true;
+  for( size_t i=0; i<n; i++)
+  {
+    if( buffer[i] != expected)
+    {
+      ok = false;
+    }
+    expected = (uint8_t) (buffer[i] + 1);
+  }
+  return( ok);
+}
+
+
+int main()
+{
+  SimFifoWire bus;
+  CommonSensorClass <SimFifoWire> sensor( bus);
+  CommonSensorFifo <SimFifoWire> fifo( sensor);
+
+  sensor.begin( 0x68);
+  fifo.begin( COUNT_REGISTER, CSC_FIFO_COUNT_SIZE_2, 0x1FFF, FIFO_REGISTER, FRAME_SIZE, FIFO_SIZE);
+  fifo.setWatermark( FRAME_SIZE * 10);
+  fifo.setOverflowRegister( STATUS_REGISTER, OVERFLOW_BIT);
+
+  uint8_t buffer[FRAME_SIZE * 20];
+
+  // Below the watermark.
+  bus.push( FRAME_SIZE * 9);
+  check( fifo.poll( buffer, sizeof( buffer)) == 0 && fifo.getCount() == FRAME_SIZE * 9, "nothing below the watermark");
+
+  // At the watermark, with half a frame extra.
+  bus.push( FRAME_SIZE + FRAME_SIZE / 2);
+  bus.transactions = 0;
+  size_t n = fifo.poll( buffer, sizeof( buffer));
+  check( n == FRAME_SIZE * 10 && sequence( buffer, n), "whole frames at the watermark");
+  check( bus.fifoCount() == FRAME_SIZE / 2, "half a frame stays in the FIFO");
+  printf( "      %lu transactions for %zu bytes\n", bus.transactions, n);
+
+  // More in the FIFO than in the buffer.
+  bus.push( FRAME_SIZE * 30);
+  n = fifo.drain( buffer, sizeof( buffer));
+  check( n == sizeof( buffer) && sequence( buffer, n), "drain() fills the buffer with whole frames");
+  n = fifo.drain( buffer, sizeof( buffer));
+  check( n == FRAME_SIZE * 10 && sequence( buffer, n), "drain() the rest");
+  check( fifo.getOverflowCount() == 0, "no overflow");
+
+  // Only after trigger() without watermark.
+  fifo.setWatermark( 0);
+  bus.push( FRAME_SIZE * 2);
+  check( fifo.poll( buffer, sizeof( buffer)) == 0, "nothing without trigger()");
+  fifo.trigger();
+  n = fifo.poll( buffer, sizeof( buffer));
+  check( n == FRAME_SIZE * 2 && sequence( buffer, n), "poll() after trigger()");
+
+  // A full FIFO is an overflow.
+  bus.reset( 0);
+  expected = 0;
+  bus.push( FIFO_SIZE + 100);
+  fifo.trigger();
+  n = fifo.poll( buffer, sizeof( buffer));
+  check( fifo.getOverflowCount() == 1, "a full FIFO is counted as overflow");
+  check( n == sizeof( buffer) && sequence( buffer, n), "the oldest frames after an overflow");
+  fifo.clearOverflowCount();
+
+  // The overflow bit of the sensor.
+  bus.reset( 0);
+  expected = 0;
+  bus.push( FIFO_SIZE + 1);
+  fifo.drain( buffer, FRAME_SIZE * 2);       // the count is not full anymore, the bit is still set
+  fifo.clearOverflowCount();
+  bus.push( 1);
+  n = fifo.drain( buffer, sizeof( buffer));
+  check( fifo.getOverflowCount() == 1, "the overflow bit is counted");
+
+  // The minimum time between two reads of the count register.
+  bus.reset( 0);
+  expected = 0;
+  fifo.clearOverflowCount();
+  fifo.setWatermark( FRAME_SIZE * 10);
+  fifo.setPollInterval( 5);
+  bus.transactions = 0;
+  for( int i=0; i<1000; i++)
+  {
+    fifo.poll( buffer, sizeof( buffer));
+  }
+  check( bus.transactions == 0, "no I2C transactions within the poll interval");
+  unsigned long received = 0;
+  bool ok = true;
+  for( int ms=0; ms<100; ms++)
+  {
+    simMillis++;
+    bus.push( FRAME_SIZE);                   // 1kHz sample rate
+    for( int i=0; i<10; i++)                 // a fast loop()
+    {
+      n = fifo.poll( buffer, sizeof( buffer));
+      ok = ok && sequence( buffer, n);
+      received += n;
+    }
+  }
+  printf( "      %lu transactions in 100ms with a poll interval of 5ms\n", bus.transactions);
+  check( ok && received + bus.fifoCount() == FRAME_SIZE * 100, "no data lost with a poll interval");
+  check( bus.transactions <= 20 * 2 + 10 * 8, "the count register is read every 5ms");
+  check( fifo.getOverflowCount() == 0, "no overflow with a poll interval");
+
+  printf( "%d failure(s)\n", failures);
+  return( failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,318 @@
+#ifndef COMMONSENSORACQUISITION_h
+#define COMMONSENSORACQUISITION_h
+
+// CommonSensorAcquisition
+// -----------------------
+// Reading sensors on more than one I2C bus at the same time, on a Linux computer.
+// This is not for the Arduino.
+//
+// Every I2C bus gets its own thread, which can be pinned to a CPU core.
+// That thread reads all the sensors of its bus over and over again.
+// When all the sensors of a bus have been read, the data is published
+// as a snapshot of that bus.
+// The busses do not wait for each other, so the sample rate does not
+// go down when more busses are added.
+//
+// The snapshot of a bus is double buffered. The application can get
+// the newest snapshot with fetch() at any moment, without a lock.
+// The thread of the bus never has to wait for the application.
+//
+// Example:
+//    CommonSensorAcquisition acquisition;
+//    int bus0 = acquisition.addBus();
+//    int bus1 = acquisition.addBus();
+//    int imu = acquisition.addRead <int16_t[6]> ( bus0, imuSensor, 0x3B);
+//    int baro = acquisition.addRead <uint8_t[3]> ( bus1, baroSensor, 0xF7);
+//    acquisition.start();
+//    ...
+//    uint8_t snapshot[64];
+//    acquisition.fetch( bus0, snapshot, sizeof( snapshot));
+//    int16_t *accelGyro = (int16_t *) &snapshot[imu];
+//
+// Compile with -pthread.
+//
+// public domain
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+
+class CommonSensorAcquisition
+{
+public:
+
+  // A task reads one sensor and stores the data at 'data'.
+  // It returns true for success.
+  typedef std::function<bool( uint8_t *data)> Task;
+
+  CommonSensorAcquisition()
+  {
+    _running = false;
+  }
+
+  ~CommonSensorAcquisition()
+  {
+    stop();
+    for( size_t i=0; i<_busses.size(); i++)
+    {
+      delete _busses[i];
+    }
+  }
+
+  // Add a bus.
+  // The 'cpu' is the CPU core for the thread of this bus, -1 to select one
+  // automatically and -2 to not pin the thread to a CPU core.
+  // The 'intervalMicros' is the time between the start of two cycles,
+  // zero means as fast as possible.
+  // return value: the number of the bus, or -1 when it failed.
+  int addBus( int cpu = -1, uint32_t intervalMicros = 0)
+  {
+    if( _running)
+    {
+      return( -1);
+    }
+    if( cpu == -1)
+    {
+      unsigned int cores = std::thread::hardware_concurrency();
+      cpu = cores > 0 ? (int) (_busses.size() % cores) : -2;
+    }
+    Bus *bus = new Bus;
+    bus->cpu = cpu;
+    bus->intervalMicros = intervalMicros;
+    bus->pinned = false;
+    bus->published.store( 0);
+    bus->buffer[0].sequence.store( 0);
+    bus->buffer[1].sequence.store( 0);
+    bus->buffer[0].cycle = 0;
+    bus->buffer[1].cycle = 0;
+    bus->cycles = 0;
+    bus->errorCount.store( 0);
+    _busses.push_back( bus);
+    return( (int) _busses.size() - 1);
+  }
+
+  // Add a task to a bus. The tasks of a bus are run in the order they are added.
+  // The 'size' is the number of bytes that the task stores in the snapshot.
+  // The buffers for the snapshot grow with every task, also after stop().
+  // return value: the offset of the data in the snapshot, or -1 when it failed.
+  int addTask( int bus, size_t size, Task task)
+  {
+    if( _running || bus < 0 || bus >= (int) _busses.size())
+    {
+      return( -1);
+    }
+    Bus *b = _busses[bus];
+    TaskEntry entry;
+    entry.task = task;
+    entry.offset = b->size;
+    b->tasks.push_back( entry);
+    b->size += size;
+    b->scratch.resize( b->size, 0);
+    b->buffer[0].data.resize( b->size, 0);
+    b->buffer[1].data.resize( b->size, 0);
+    return( (int) entry.offset);
+  }
+
+  // Add a get() of a CommonSensorClass object as a task.
+  // The type 'T' is the variable for the get(), for example int16_t[3].
+  template <typename T, class T_SENSOR> int addRead( int bus, T_SENSOR & sensor, uint16_t registerAddress)
+  {
+    return( addTask( bus, sizeof( T), [&sensor, registerAddress]( uint8_t *data)
+    {
+      return( sensor.get( registerAddress, *(T *) data));
+    }));
+  }
+
+  // Start a thread for every bus.
+  // A thread that can not be pinned to its CPU core still runs, see isPinned().
+  bool start()
+  {
+    if( _running || _busses.empty())
+    {
+      return( false);
+    }
+    _running = true;
+    for( size_t i=0; i<_busses.size(); i++)
+    {
+      Bus *b = _busses[i];
+      b->thread = std::thread( &CommonSensorAcquisition::_worker, this, b);
+      if( b->cpu >= 0)
+      {
+        cpu_set_t cpuSet;
+        CPU_ZERO( &cpuSet);
+        CPU_SET( b->cpu, &cpuSet);
+        b->pinned = pthread_setaffinity_np( b->thread.native_handle(), sizeof( cpuSet), &cpuSet) == 0;
+      }
+    }
+    return( true);
+  }
+
+  // Stop all the threads. The last snapshots can still be fetched.
+  void stop()
+  {
+    if( !_running)
+    {
+      return;
+    }
+    _running = false;
+    for( size_t i=0; i<_busses.size(); i++)
+    {
+      if( _busses[i]->thread.joinable())
+      {
+        _busses[i]->thread.join();
+      }
+    }
+  }
+
+  // The number of bytes of the snapshot of a bus.
+  size_t getSnapshotSize( int bus)
+  {
+    if( bus < 0 || bus >= (int) _busses.size())
+    {
+      return( 0);
+    }
+    return( _busses[bus]->size);
+  }
+
+  // Copy the newest snapshot of a bus, without a lock.
+  // When the thread of the bus overwrites the snapshot while it is copied,
+  // then it is copied again.
+  // return value: the number of the cycle of the snapshot, zero when there is no snapshot yet.
+  // Nothing is copied when there is no snapshot yet.
+  uint32_t fetch( int bus, uint8_t *data, size_t size)
+  {
+    if( bus < 0 || bus >= (int) _busses.size())
+    {
+      return( 0);
+    }
+    Bus *b = _busses[bus];
+
+    while( true)
+    {
+      Buffer & buffer = b->buffer[b->published.load( std::memory_order_acquire)];
+      uint32_t sequence = buffer.sequence.load( std::memory_order_acquire);
+      if( (sequence & 1) != 0)
+      {
+        continue;                     // being written right now
+      }
+      uint32_t cycle = buffer.cycle;
+      if( cycle == 0)
+      {
+        return( 0);                   // the thread of the bus has not finished a cycle yet
+      }
+      if( size > buffer.data.size())
+      {
+        size = buffer.data.size();
+      }
+      memcpy( data, buffer.data.data(), size);
+      std::atomic_thread_fence( std::memory_order_acquire);
+      if( buffer.sequence.load( std::memory_order_relaxed) == sequence)
+      {
+        return( cycle);
+      }
+    }
+  }
+
+  // Test if the thread of a bus runs on the CPU core that was selected with addBus().
+  // It fails for example when that CPU core is not allowed for this process.
+  // return value: true when the thread is pinned, false when it is not.
+  bool isPinned( int bus)
+  {
+    if( bus < 0 || bus >= (int) _busses.size())
+    {
+      return( false);
+    }
+    return( _busses[bus]->pinned);
+  }
+
+  // The number of tasks of a bus that returned false.
+  uint32_t getErrorCount( int bus)
+  {
+    if( bus < 0 || bus >= (int) _busses.size())
+    {
+      return( 0);
+    }
+    return( _busses[bus]->errorCount.load());
+  }
+
+private:
+  struct TaskEntry
+  {
+    Task task;
+    size_t offset;
+  };
+
+  // One of the two buffers of a snapshot.
+  // The sequence is odd while it is written.
+  struct Buffer
+  {
+    std::atomic<uint32_t> sequence;
+    uint32_t cycle;
+    std::vector<uint8_t> data;
+  };
+
+  struct Bus
+  {
+    Bus() : size( 0) {}
+    int cpu;
+    bool pinned;                      // the thread runs on the selected CPU core
+    uint32_t intervalMicros;
+    std::vector<TaskEntry> tasks;
+    size_t size;                      // the size of the snapshot
+    std::vector<uint8_t> scratch;     // the tasks store their data here
+    Buffer buffer[2];
+    std::atomic<int> published;       // the buffer with the newest snapshot
+    uint32_t cycles;
+    std::atomic<uint32_t> errorCount;
+    std::thread thread;
+  };
+
+  void _worker( Bus *b)
+  {
+    auto next = std::chrono::steady_clock::now();
+    while( _running)
+    {
+      for( size_t i=0; i<b->tasks.size(); i++)
+      {
+        if( !b->tasks[i].task( b->scratch.data() + b->tasks[i].offset))
+        {
+          b->errorCount++;
+        }
+      }
+
+      // Write the new snapshot in the buffer that is not published.
+      // The sequence is made odd while writing, for a fetch() that
+      // is still copying this buffer from the previous cycle.
+      b->cycles++;
+      int index = 1 - b->published.load( std::memory_order_relaxed);
+      Buffer & buffer = b->buffer[index];
+      uint32_t sequence = buffer.sequence.load( std::memory_order_relaxed);
+      buffer.sequence.store( sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence( std::memory_order_release);
+      buffer.cycle = b->cycles;
+      memcpy( buffer.data.data(), b->scratch.data(), b->size);
+      buffer.sequence.store( sequence + 2, std::memory_order_release);
+      b->published.store( index, std::memory_order_release);
+
+      if( b->intervalMicros != 0)
+      {
+        next += std::chrono::microseconds( b->intervalMicros);
+        std::this_thread::sleep_until( next);
+      }
+    }
+  }
+
+  std::vector<Bus *> _busses;
+  std::atomic<bool> _running;
+};
+
+#endif
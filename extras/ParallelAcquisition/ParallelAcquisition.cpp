@@ -0,0 +1,297 @@
+// ParallelAcquisition
+// -------------------
+// Example and test for the CommonSensorAcquisition on a Linux computer.
+// This is not for the Arduino.
+//
+// A number of simulated I2C busses are used, every bus has a few simulated sensors.
+// A simulated bus takes as much time as a real I2C bus at 400kHz.
+// The sample rate is measured with 1, 2, 3 and 4 busses.
+// With a thread per bus, the sample rate of every bus should stay the same,
+// so the total number of samples per second grows with the number of busses.
+//
+// The simulated sensors return a pattern that depends on the cycle.
+// While the threads are running, fetch() is called over and over again
+// and every snapshot is checked: all the data must be from the cycle
+// that fetch() returns, and the cycles may not go back.
+// The return value is not zero when something is wrong.
+//
+// Compile:
+//    g++ -O2 -pthread -I../.. -o ParallelAcquisition ParallelAcquisition.cpp
+//
+// public domain
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "CommonSensorClass.h"
+#include "CommonSensorAcquisition.h"
+
+
+// A simulated I2C bus with a Wire compatible interface.
+// Every sensor on the bus has 256 registers with a one byte register address.
+// The value of a register is a pattern of the cycle, the sensor and the register address.
+// The time for every I2C transaction is waited, about 9 bits per byte.
+class SimBus
+{
+public:
+  SimBus( uint32_t clock = 400000UL) : _clock( clock)
+  {
+    _cycle = 0;
+  }
+
+  // Called by the first task of a cycle, so the sensors have new data.
+  void nextCycle()
+  {
+    _cycle++;
+  }
+
+  // The value of a register in a cycle.
+  static uint8_t pattern( uint32_t cycle, uint8_t address, uint8_t registerAddress)
+  {
+    return( (uint8_t) (cycle * 7 + (address & 0x07) * 31 + registerAddress));
+  }
+
+  void begin( void) {}
+  void end( void) {}
+  void beginTransmission( uint8_t address)
+  {
+    _address = address & 0x07;
+    _index = 0;
+  }
+  size_t write( uint8_t data)
+  {
+    if( _index == 0)
+    {
+      _register = data;             // the rest of the data is ignored
+    }
+    _index++;
+    return( 1);
+  }
+  uint8_t endTransmission( bool stop = true)
+  {
+    (void) stop;
+    _wait( _index + 1);
+    return( 0);
+  }
+  uint8_t requestFrom( uint8_t address, uint8_t length)
+  {
+    _address = address & 0x07;
+    _wait( length + 1);
+    return( length);
+  }
+  int read( void)
+  {
+    return( pattern( _cycle, _address, _register++));
+  }
+
+private:
+  void _wait( size_t bytes)
+  {
+    std::this_thread::sleep_for( std::chrono::nanoseconds( (uint64_t) bytes * 9 * 1000000000ULL / _clock));
+  }
+
+  uint32_t _clock;
+  uint32_t _cycle;
+  uint8_t _address;
+  uint8_t _register;
+  size_t _index;
+};
+
+
+#define MAX_BUSSES 4
+#define SENSORS_PER_BUS 3
+#define SENSOR_REGISTER 0x3B
+
+
+static unsigned long failures = 0;
+
+// Check a snapshot of a bus with the cycle that fetch() returned.
+// The get() has stored the int16_t values in the order of the computer.
+static void check( const uint8_t *snapshot, uint32_t cycle)
+{
+  for( int s=0; s<SENSORS_PER_BUS; s++)
+  {
+    for( int i=0; i<6; i++)
+    {
+      uint8_t registerAddress = (uint8_t) (SENSOR_REGISTER + 2 * i);
+      uint16_t expected = (uint16_t) ((SimBus::pattern( cycle, 0x68 + s, registerAddress) << 8) |
+                                      SimBus::pattern( cycle, 0x68 + s, registerAddress + 1));
+      int16_t value;
+      memcpy( &value, &snapshot[(s * 6 + i) * 2], 2);
+      if( (uint16_t) value != expected)
+      {
+        if( failures < 10)
+        {
+          printf( "FAIL: cycle %u, sensor %d, value %d is 0x%04X, expected 0x%04X\n",
+                  cycle, s, i, (uint16_t) value, expected);
+        }
+        failures++;
+        return;
+      }
+    }
+  }
+}
+
+
+// Run the acquisition with a number of busses for a while
+// and return the total number of samples per second.
+// All the time, the snapshots are fetched and checked.
+static double measure( int busCount)
+{
+  SimBus *busses[MAX_BUSSES];
+  CommonSensorClass <SimBus> *sensors[MAX_BUSSES][SENSORS_PER_BUS];
+  CommonSensorAcquisition acquisition;
+
+  for( int b=0; b<busCount; b++)
+  {
+    SimBus *sim = busses[b] = new SimBus();
+    int bus = acquisition.addBus();
+    acquisition.addTask( bus, 0, [sim]( uint8_t *data)
+    {
+      (void) data;
+      sim->nextCycle();
+      return( true);
+    });
+    for( int s=0; s<SENSORS_PER_BUS; s++)
+    {
+      sensors[b][s] = new CommonSensorClass <SimBus> ( *busses[b]);
+      sensors[b][s]->begin( 0x68 + s);
+      acquisition.addRead <int16_t[6]> ( bus, *sensors[b][s], SENSOR_REGISTER);
+    }
+  }
+
+  acquisition.start();
+  for( int b=0; b<busCount; b++)
+  {
+    if( !acquisition.isPinned( b))
+    {
+      printf( "Warning, the thread of bus %d is not pinned to a CPU core\n", b);
+    }
+  }
+
+  // Fetch and check the snapshots while the threads are running.
+  uint8_t snapshot[6 * 2 * SENSORS_PER_BUS];
+  uint32_t firstCycle[MAX_BUSSES];
+  uint32_t lastCycle[MAX_BUSSES];
+  unsigned long fetches = 0;
+  auto start = std::chrono::steady_clock::now();
+  for( int b=0; b<busCount; b++)
+  {
+    firstCycle[b] = lastCycle[b] = acquisition.fetch( b, snapshot, sizeof( snapshot));
+  }
+  while( std::chrono::steady_clock::now() - start < std::chrono::milliseconds( 500))
+  {
+    for( int b=0; b<busCount; b++)
+    {
+      uint32_t cycle = acquisition.fetch( b, snapshot, sizeof( snapshot));
+      fetches++;
+      if( cycle < lastCycle[b])
+      {
+        printf( "FAIL: bus %d went back from cycle %u to %u\n", b, lastCycle[b], cycle);
+        failures++;
+      }
+      lastCycle[b] = cycle;
+      if( cycle != 0)
+      {
+        check( snapshot, cycle);
+      }
+    }
+  }
+  uint64_t samples = 0;
+  for( int b=0; b<busCount; b++)
+  {
+    samples += lastCycle[b] - firstCycle[b];
+    if( lastCycle[b] == 0)
+    {
+      printf( "FAIL: bus %d has no snapshot\n", b);
+      failures++;
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+  acquisition.stop();
+
+  uint32_t errors = 0;
+  for( int b=0; b<busCount; b++)
+  {
+    errors += acquisition.getErrorCount( b);
+    for( int s=0; s<SENSORS_PER_BUS; s++)
+    {
+      delete sensors[b][s];
+    }
+    delete busses[b];
+  }
+  if( errors != 0)
+  {
+    printf( "FAIL: %u tasks failed\n", errors);
+    failures++;
+  }
+  printf( "%lu snapshots fetched and checked\n", fetches);
+
+  double seconds = std::chrono::duration<double>( stop - start).count();
+  return( (double) samples / seconds);
+}
+
+
+// A fetch() before start() and after a task is added after stop().
+static void checkFetch()
+{
+  SimBus sim;
+  CommonSensorClass <SimBus> sensor( sim);
+  sensor.begin( 0x68);
+  CommonSensorAcquisition acquisition;
+  int bus = acquisition.addBus( -2);
+  acquisition.addRead <int16_t[6]> ( bus, sensor, SENSOR_REGISTER);
+
+  uint8_t snapshot[64];
+  memset( snapshot, 0x55, sizeof( snapshot));
+  if( acquisition.fetch( bus, snapshot, sizeof( snapshot)) != 0 || snapshot[0] != 0x55)
+  {
+    printf( "FAIL: fetch() before start()\n");
+    failures++;
+  }
+
+  acquisition.start();
+  while( acquisition.fetch( bus, snapshot, sizeof( snapshot)) < 2)
+  {
+    std::this_thread::yield();
+  }
+  acquisition.stop();
+
+  // The snapshot grows, the part of the new task is zero until the next start().
+  int offset = acquisition.addRead <int16_t[6]> ( bus, sensor, SENSOR_REGISTER);
+  memset( snapshot, 0x55, sizeof( snapshot));
+  uint32_t cycle = acquisition.fetch( bus, snapshot, sizeof( snapshot));
+  if( offset != 12 || cycle < 2 || acquisition.getSnapshotSize( bus) != 24 ||
+      snapshot[offset] != 0 || snapshot[24] != 0x55)
+  {
+    printf( "FAIL: fetch() after addTask() after stop()\n");
+    failures++;
+  }
+}
+
+
+int main()
+{
+  printf( "CommonSensorAcquisition with simulated I2C busses\n");
+  printf( "%d sensors per bus, 12 bytes per sensor, 400kHz\n", SENSORS_PER_BUS);
+
+  checkFetch();
+
+  double single = 0.0;
+  for( int n=1; n<=MAX_BUSSES; n++)
+  {
+    double rate = measure( n);
+    if( n == 1)
+    {
+      single = rate;
+    }
+    printf( "%d bus(ses): %8.0f samples/s, %.2f times one bus\n", n, rate, single > 0.0 ? rate / single : 0.0);
+  }
+
+  printf( "%lu failure(s)\n", failures);
+  return( failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,62 @@
+#!/bin/sh
+#
+# size_report.sh
+# --------------
+# Shows how much Flash and RAM the CommonSensorClass uses in a compiled sketch.
+# Every function of a template is listed, with its size in bytes.
+#
+# Use:
+#    size_report.sh sketch.elf
+#
+# The ELF file is in the build folder of the Arduino IDE (turn on the verbose
+# output for compilation to see where that is), or use:
+#    arduino-cli compile --fqbn arduino:avr:uno --output-dir build MySketch
+#
+# The avr-nm of the AVR toolchain is used by default, another one can be selected with:
+#    NM=arm-none-eabi-nm size_report.sh sketch.elf
+#
+# Functions that are inlined by the compiler are not in the list,
+# their code is part of the function that calls them.
+#
+# public domain
+
+NM=${NM:-avr-nm}
+
+if [ $# -lt 1 ]; then
+  echo "Use: $0 sketch.elf [pattern]" >&2
+  echo "The default pattern is CommonSensor" >&2
+  exit 1
+fi
+
+ELF=$1
+PATTERN=${2:-CommonSensor}
+
+"$NM" --size-sort --print-size --radix=d --demangle "$ELF" | awk -v pattern="$PATTERN" '
+  index( $0, pattern) > 0 {
+    size = $2 + 0
+    type = $3
+    name = $4
+    for( i = 5; i <= NF; i++) name = name " " $i
+    if( type ~ /^[TtWw]$/) {
+      area = "Flash"
+      flash += size
+    } else if( type ~ /^[Dd]$/) {
+      # Initialized data is in Flash and is copied to RAM at startup.
+      area = "Both"
+      flash += size
+      ram += size
+    } else if( type ~ /^[Bb]$/) {
+      area = "RAM"
+      ram += size
+    } else if( type ~ /^[Rr]$/) {
+      area = "Flash"
+      flash += size
+    } else {
+      area = type
+    }
+    printf( "%6d  %-5s  %s\n", size, area, name)
+    count++
+  }
+  END {
+    printf( "\n%d functions and variables, Flash %d bytes, RAM %d bytes\n", count, flash, ram)
+  }'
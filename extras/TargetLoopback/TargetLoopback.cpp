@@ -0,0 +1,253 @@
+// TargetLoopback
+// --------------
+// Test for the CommonSensorTarget on a Linux computer.
+// This is not for the Arduino.
+//
+// A simulated I2C bus connects a CommonSensorClass (the Master) with
+// a CommonSensorTarget (the Slave), just like the SimulateEEPROM example
+// simulates an I2C EEPROM.
+// The Master reads and writes the registers of the Slave with put() and get().
+//
+// Compile:
+//    g++ -O2 -I../.. -o TargetLoopback TargetLoopback.cpp
+//
+// public domain
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+#include "CommonSensorClass.h"
+#include "CommonSensorTarget.h"
+
+
+// A simulated I2C bus with both the Master and the Slave functions of a Wire library.
+// The data of the Master is given to the onReceive function of the Slave,
+// and the onRequest function of the Slave is called for a Wire.requestFrom().
+class LoopbackWire
+{
+public:
+  LoopbackWire()
+  {
+    _onReceive = NULL;
+    _onRequest = NULL;
+    _inRequest = false;
+    _address = 0;
+  }
+
+  // Master functions
+  void begin( void) {}
+  void end( void) {}
+  void beginTransmission( uint8_t address)
+  {
+    _txAddress = address;
+    _txLength = 0;
+  }
+  uint8_t endTransmission( bool stop = true)
+  {
+    (void) stop;
+    if( _txAddress != _address || _onReceive == NULL)
+    {
+      return( 2);                    // no acknowledge of the I2C address
+    }
+    memcpy( _rxBuffer, _txBuffer, _txLength);
+    _rxLength = _txLength;
+    _rxIndex = 0;
+    _onReceive( (int) _txLength);
+    return( 0);
+  }
+  uint8_t requestFrom( uint8_t address, uint8_t length)
+  {
+    if( address != _address || _onRequest == NULL)
+    {
+      return( 0);
+    }
+    _rxLength = 0;
+    _inRequest = true;
+    _onRequest();
+    _inRequest = false;
+    requests++;
+    // The Master reads only what it asked for.
+    if( _rxLength > length)
+    {
+      _rxLength = length;
+    }
+    _rxIndex = 0;
+    return( (uint8_t) _rxLength);
+  }
+
+  // Slave functions
+  void begin( uint8_t address)
+  {
+    _address = address;
+  }
+  void onReceive( void (*function)( int))
+  {
+    _onReceive = function;
+  }
+  void onRequest( void (*function)( void))
+  {
+    _onRequest = function;
+  }
+
+  // Used by both
+  size_t write( uint8_t data)
+  {
+    return( write( &data, 1));
+  }
+  size_t write( const uint8_t *pData, size_t length)
+  {
+    uint8_t *buffer = _inRequest ? _rxBuffer : _txBuffer;
+    size_t &used = _inRequest ? _rxLength : _txLength;
+    if( used + length > sizeof( _txBuffer))
+    {
+      length = sizeof( _txBuffer) - used;
+    }
+    memcpy( buffer + used, pData, length);
+    used += length;
+    return( length);
+  }
+  int available( void)
+  {
+    return( (int) (_rxLength - _rxIndex));
+  }
+  int read( void)
+  {
+    if( _rxIndex >= _rxLength)
+    {
+      return( -1);
+    }
+    return( _rxBuffer[_rxIndex++]);
+  }
+
+  unsigned long requests = 0;
+
+private:
+  void (*_onReceive)( int);
+  void (*_onRequest)( void);
+  bool _inRequest;
+  uint8_t _address;
+  uint8_t _txAddress;
+  uint8_t _txBuffer[COMMONSENSORCLASS_WIRE_BUFFER_SIZE];
+  size_t _txLength;
+  uint8_t _rxBuffer[COMMONSENSORCLASS_WIRE_BUFFER_SIZE];
+  size_t _rxLength;
+  size_t _rxIndex;
+};
+
+
+static int failures = 0;
+
+static void check( bool ok, const char *text)
+{
+  printf( "%s: %s\n", ok ? "ok  " : "FAIL", text);
+  if( !ok)
+  {
+    failures++;
+  }
+}
+
+static uint16_t writtenRegister;
+static size_t writtenSize;
+
+static void written( uint16_t registerAddress, size_t size)
+{
+  writtenRegister = registerAddress;
+  writtenSize = size;
+}
+
+
+int main()
+{
+  LoopbackWire bus;
+  CommonSensorTarget <LoopbackWire, 256> target( bus);
+  CommonSensorClass <LoopbackWire> master( bus);
+
+  target.begin( 0x30);
+  target.onWrite( written);
+  master.begin( 0x30);
+
+  check( master.exists(), "the Slave responds");
+
+  // Values that are not published yet are not visible.
+  const int16_t imu[6] = { 1, -2, 300, -4000, 32000, -32000};
+  target.put( 0x10, imu);
+  int16_t readImu[6];
+  master.get( 0x10, readImu);
+  check( readImu[0] == 0 && readImu[5] == 0, "no new values before publish()");
+
+  target.publish();
+  check( master.get( 0x10, readImu) && memcmp( imu, readImu, sizeof( imu)) == 0, "int16_t array after publish()");
+
+  const uint32_t counter = 0x12345678UL;
+  target.put( 0x40, counter);
+  target.publish();
+  check( master.readU32( 0x40) == counter, "readU32()");
+  check( master.readByte( 0x40) == 0x12, "MSB first");
+
+  // More data than the buffer of the Wire library.
+  uint8_t block[100];
+  for( int i=0; i<100; i++)
+  {
+    block[i] = (uint8_t) (i * 3);
+  }
+  target.put( 0x80, *block, sizeof( block));
+  target.publish();
+  uint8_t readBlock[100];
+  master.get( 0x80, *readBlock, sizeof( readBlock));
+  check( memcmp( block, readBlock, sizeof( block)) == 0, "100 bytes in parts");
+
+  // A struct that is not a multiple of the element size, only whole elements are used.
+  struct __attribute__(( packed))
+  {
+    uint32_t first;
+    uint16_t second;
+  } odd = { 0x11223344UL, 0x5566};
+  target.put( 0xF8, 0xAAAAAAAAUL);
+  target.put( 0xFC, (uint32_t) 0);
+  check( target.put( 0xF8, odd, 4), "struct with 6 bytes as 4 byte elements");
+  target.publish();
+  check( master.readU32( 0xF8) == 0x11223344UL && master.readU32( 0xFC) == 0, "only the whole element is stored");
+  memset( &odd, 0, sizeof( odd));
+  check( target.get( 0xF8, odd, 4) && odd.first == 0x11223344UL && odd.second == 0, "only the whole element is read");
+
+  // The Master writes a register.
+  master.writeU16( 0x20, 0xABCD);
+  uint16_t value = 0;
+  target.get( 0x20, value);
+  check( value == 0xABCD && writtenRegister == 0x20 && writtenSize == 2, "the Master writes a register");
+
+  // A value written by the Master stays after a publish().
+  target.put( 0x10, imu[0]);
+  target.publish();
+  check( master.readU16( 0x20) == 0xABCD, "written register after publish()");
+
+  // Two byte register address and LSB first.
+  CommonSensorTarget <LoopbackWire, 1024> target2( bus);
+  target2.begin( 0x31, CSC_REGISTER_ADDRESS_SIZE_2 | CSC_SENSOR_LSB_FIRST);
+  CommonSensorClass <LoopbackWire> master2( bus);
+  master2.begin( 0x31, CSC_REGISTER_ADDRESS_SIZE_2 | CSC_SENSOR_LSB_FIRST);
+  const int32_t values[3] = { -1, 123456789, -987654321};
+  target2.put( 0x300, values);
+  target2.publish();
+  int32_t readValues[3];
+  master2.get( 0x300, readValues);
+  check( memcmp( values, readValues, sizeof( values)) == 0, "two byte register address, LSB first");
+
+  // The time for the interrupt routine of onRequest.
+  const unsigned long count = 1000000UL;
+  bus.requests = 0;
+  auto start = std::chrono::steady_clock::now();
+  for( unsigned long i=0; i<count; i++)
+  {
+    bus.requestFrom( 0x31, COMMONSENSORCLASS_WIRE_BUFFER_SIZE);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>( stop - start).count() / (double) bus.requests;
+  printf( "onRequest with %d bytes: %.0f ns\n", COMMONSENSORCLASS_WIRE_BUFFER_SIZE, ns);
+
+  printf( "%d failure(s)\n", failures);
+  return( failures == 0 ? 0 : 1);
+}